@@ -29,7 +29,7 @@ void draw_bar(Monitor *monitor) {
   unsigned int i, occ = 0, urg = 0;
   Client *client;
 
-  if (!monitor->showbar)
+  if (!monitor->showbar || monitor->game)
     return;
 
 
@@ -117,7 +117,8 @@ void create_bars(void) {
   Monitor *monitor;
   XSetWindowAttributes wa = {.override_redirect = True,
                              .background_pixmap = ParentRelative,
-                             .event_mask = ButtonPressMask | ExposureMask};
+                             .event_mask = ButtonPressMask | ExposureMask |
+                                           EnterWindowMask};
   XClassHint ch = {"pwindow_manager", "pwindow_manager"};
   for (monitor = monitors; monitor; monitor = monitor->next) {
     if (monitor->bar_window)
@@ -136,6 +137,17 @@ void create_bars(void) {
   }
 }
 
+/* the shared draw surface only ever holds one bar, it follows the widest */
+void resize_bar_surface(void) {
+  Monitor *monitor;
+  unsigned int width = 1;
+
+  for (monitor = monitors; monitor; monitor = monitor->next)
+    width = MAX(width, (unsigned int)monitor->window_area_width);
+  if (drw->w != width || drw->h != (unsigned int)bar_height)
+    drw_resize(drw, width, bar_height);
+}
+
 void updatebarpos(Monitor *m) {
   m->window_area_y = m->screen_y;
   m->window_area_height = m->screen_height;
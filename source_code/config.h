@@ -13,6 +13,17 @@
 
 static const unsigned int borderpx  = 3;        /* border pixel of windows */
 static const unsigned int snap      = 32;       /* snap pixel */
+static const int snap_windows       = 1;        /* 1 also snaps to the sides of floating windows */
+static const int repeat_hold_ms     = 100;      /* gap between key repeats that still counts as holding */
+static const float repeat_accel     = 1.0;      /* extra steps per second a moveresize key is held */
+static const float repeat_accel_max = 6.0;      /* largest step multiplier of a held key */
+static const int sync_resize        = 1;        /* 1 waits for clients speaking _NET_WM_SYNC_REQUEST to paint each size */
+static const int sync_timeout       = 100;      /* ms to wait for such a client before sending the next size */
+static const int outline_drag       = 0;        /* 1 drags an outline and configures the window on release */
+static const int outline_apply_ms   = 0;        /* in outline drags also configure every that many ms, 0 only on release */
+static const int place_floating_windows = 1;    /* 1 places new floating windows without a position where they overlap least */
+static const int highlightpx        = 25;       /* width of the focused monitor ring */
+static const int highlight_ms       = 1000;     /* how long the ring is shown */
 static const int showbar            = 1;        /* 0 means no bar */
 static const int topbar             = 1;        /* 0 means bottom bar */
 static const char *fonts[]          = { "monospace:size=13" };
@@ -37,16 +48,16 @@ static const Rule rules[] = {
 	 *	WM_CLASS(STRING) = instance, class
 	 *	WM_NAME(STRING) = title
 	 */
-	/* class      instance    title       tags mask     isfloating   monitor */
-	{ "Gimp",     NULL,       NULL,       0,            1,           -1 },
-	{ NULL,				NULL,       "pengine",       0,            1,           -1 },
-	{ "prufus",   NULL,       "prufus",       0,            1,           -1 },
-	{ "swordfish",   NULL,       "swordfish",       0,            1,           -1 },
-	{ "Select File - prufus",   NULL,       "Select File - prufus",       0,            1,           -1 },
-	{ "XVkbd",    NULL,       "xvkbd - Virtual Keyboard",       0,            1,           -1 },
-	{ "Godot",     "Godot_Engine",       "basket (DEBUG)",       0,            1,           0 },
-	{ "basket",     "Godot_Engine",       "basket (DEBUG)",       0,            1,           0 },
-	{ "speed_mostsimple",     "Godot_Engine",       "speed_mostsimple (DEBUG)",       0,            1,           -1 },
+	/* class      instance    title       tags mask     isfloating   monitor   isgame */
+	{ "Gimp",     NULL,       NULL,       0,            1,           -1,       0 },
+	{ NULL,				NULL,       "pengine",       0,            1,           -1,       0 },
+	{ "prufus",   NULL,       "prufus",       0,            1,           -1,       0 },
+	{ "swordfish",   NULL,       "swordfish",       0,            1,           -1,       0 },
+	{ "Select File - prufus",   NULL,       "Select File - prufus",       0,            1,           -1,       0 },
+	{ "XVkbd",    NULL,       "xvkbd - Virtual Keyboard",       0,            1,           -1,       0 },
+	{ "Godot",     "Godot_Engine",       "basket (DEBUG)",       0,            1,           0,        1 },
+	{ "basket",     "Godot_Engine",       "basket (DEBUG)",       0,            1,           0,        1 },
+	{ "speed_mostsimple",     "Godot_Engine",       "speed_mostsimple (DEBUG)",       0,            1,           -1,       1 },
 };
 
 /* layout(s) */
@@ -55,6 +66,17 @@ static const int nmaster     = 1;    /* number of clients in master area */
 static const int nviews      = 3;    /* mask of tags highlighted by default (tags 1-4) */
 static const int resizehints = 0;    /* 1 means respect size hints in tiled resizals */
 static const int lockfullscreen = 1; /* 1 will force focus on the fullscreen window */
+static const int game_nice = -10; /* nice value of game clients, below 0 needs CAP_SYS_NICE */
+static const int monocle_presize = 1; /* 1 also sizes the client after the focused one in monocle */
+static const int hidden_unmap = 0; /* 1 unmaps clients of hidden tags instead of moving them off screen */
+static const int report_xrequests = 0; /* 1 prints X requests sent vs. suppressed per second */
+static const int report_drag_latency = 0; /* 1 prints pointer to configure latency after each mouse move or resize */
+static const int report_key_latency = 0; /* 1 prints press to action latency of each key and the events it jumped */
+static const int report_click_latency = 0; /* 1 prints how long a click on a client waited before being replayed */
+static const int nview_warp = 0; /* 1 warps to and highlights the selected monitor after nview, ntoggleview and reset_view */
+static const int focus_dwell_ms = 30; /* ms the pointer rests in a window before it is focused, 0 focuses on every crossing */
+static const int focus_sweep_px = 20; /* pointer moving more than this per dwell is still sweeping */
+static const int hotplug_grace = 3000; /* ms clients of a vanished output wait for it before moving to the first monitor */
 
 
 static const float facts[1];    //static const float facts[]     = {     0,     0.5 }; // = mfact   // 50%
@@ -97,6 +119,25 @@ static const char *screenshot_select[]  = { "scrot", "-s", NULL };
 static const char *volume_up[]  = { "volume_up", NULL };
 static const char *volume_down[]  = { "volume_down", NULL };
 
+/* resize mode: hjkl resize the floating window, shift moves it */
+static const Key resize_keys[] = {
+	/* modifier                     key        function        argument */
+	{ 0,                            XK_h,      moveresize,     {.v = (int []){ 0, 0, -25, 0 }}},
+	{ 0,                            XK_l,      moveresize,     {.v = (int []){ 0, 0, 25, 0 }}},
+	{ 0,                            XK_k,      moveresize,     {.v = (int []){ 0, 0, 0, -25 }}},
+	{ 0,                            XK_j,      moveresize,     {.v = (int []){ 0, 0, 0, 25 }}},
+	{ ShiftMask,                    XK_h,      moveresize,     {.v = (int []){ -25, 0, 0, 0 }}},
+	{ ShiftMask,                    XK_l,      moveresize,     {.v = (int []){ 25, 0, 0, 0 }}},
+	{ ShiftMask,                    XK_k,      moveresize,     {.v = (int []){ 0, -25, 0, 0 }}},
+	{ ShiftMask,                    XK_j,      moveresize,     {.v = (int []){ 0, 25, 0, 0 }}},
+	{ 0,                            XK_Escape, leave_submap,   {0} },
+	{ 0,                            XK_Return, leave_submap,   {0} },
+};
+
+static const Submap submaps[] = {
+	/* name       keys             length                oneshot */
+	{ "resize",   resize_keys,     LENGTH(resize_keys),  0 },
+};
 
 static const Key keys[] = {
 	/* modifier                     key        function        argument */
@@ -110,6 +151,7 @@ static const Key keys[] = {
 	{ MODKEY|ShiftMask,							XK_m,			spawn,          {.v = volume_up} },
 	{ MODKEY|ShiftMask,							XK_n,			spawn,          {.v = volume_down} },
 	{ MODKEY,                       XK_b,      togglebar,      {0} },
+	{ MODKEY,                       XK_r,      enter_submap,   {.v = &submaps[0] } },
 	{ MODKEY,                       XK_j,      focusstack,     {.i = +1 } },
 	{ MODKEY,                       XK_k,      focusstack,     {.i = -1 } },
 	//{ MODKEY|ShiftMask,             XK_j,      pushdown,       {0} },
@@ -134,6 +176,14 @@ static const Key keys[] = {
 	{ MODKEY,                       XK_period, focus_monitor,       {.i = +1 } },
 	{ MODKEY|ShiftMask,             XK_comma,  tagmon,         {.i = -1 } },
 	{ MODKEY|ShiftMask,             XK_period, tagmon,         {.i = +1 } },
+	{ MODKEY,                       XK_Left,   focus_monitor_direction, {.i = DirLeft } },
+	{ MODKEY,                       XK_Right,  focus_monitor_direction, {.i = DirRight } },
+	{ MODKEY,                       XK_Up,     focus_monitor_direction, {.i = DirUp } },
+	{ MODKEY,                       XK_Down,   focus_monitor_direction, {.i = DirDown } },
+	{ MODKEY|ShiftMask,             XK_Left,   tagmon_direction, {.i = DirLeft } },
+	{ MODKEY|ShiftMask,             XK_Right,  tagmon_direction, {.i = DirRight } },
+	{ MODKEY|ShiftMask,             XK_Up,     tagmon_direction, {.i = DirUp } },
+	{ MODKEY|ShiftMask,             XK_Down,   tagmon_direction, {.i = DirDown } },
 	TAGKEYS(                        XK_1,                      0)
 	TAGKEYS(                        XK_2,                      1)
 	TAGKEYS(                        XK_3,                      2)
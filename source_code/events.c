@@ -1,8 +1,13 @@
 #include "events.h"
 
 #include "pwindow_manager.h"
+#include "config.h"
 #include "windows.h"
+#include "shadow.h"
+#include "floating.h"
+#include "timer.h"
 #include <X11/Xatom.h>
+#include <X11/extensions/Xrandr.h>
 
 #include "bar.h"
 
@@ -42,32 +47,52 @@ void configure(Client *c) {
   XSendEvent(display, c->win, False, StructureNotifyMask, (XEvent *)&ce);
 }
 
-void configurenotify(XEvent *e) {
+/* brings the monitors that were marked dirty by updategeom up to date */
+static void update_dirty_monitors(void) {
   Monitor *m;
   Client *c;
-  XConfigureEvent *ev = &e->xconfigure;
-  int dirty;
-
-  /* TODO: updategeom handling sucks, needs to be simplified */
-  if (ev->window == root) {
-    dirty = (display_width != ev->width || display_height != ev->height);
-    display_width = ev->width;
-    display_height = ev->height;
-    if (updategeom() || dirty) {
-      drw_resize(drw, display_width, bar_height);
-      create_bars();
-      for (m = monitors; m; m = m->next) {
-        for (c = m->clients; c; c = c->next)
-          if (c->isfullscreen)
-            resizeclient(c, m->screen_x, m->screen_y, m->screen_width,
-                         m->screen_height);
-        XMoveResizeWindow(display, m->bar_window, m->window_area_x, m->bar_geometry,
-                          m->window_area_width, bar_height);
-      }
-      focus(NULL);
-      arrange(NULL);
-    }
+
+  create_bars();
+  resize_bar_surface();
+  update_sensors();
+  for (m = monitors; m; m = m->next) {
+    if (!m->dirty)
+      continue;
+    for (c = m->clients; c; c = c->next)
+      if (c->isfullscreen)
+        resizeclient(c, m->screen_x, m->screen_y, m->screen_width,
+                     m->screen_height);
+    XMoveResizeWindow(display, m->bar_window, m->window_area_x,
+                      m->bar_geometry, m->window_area_width, bar_height);
+    arrange(m);
+    m->dirty = 0;
   }
+  focus(NULL);
+}
+
+void configurenotify(XEvent *e) {
+  XConfigureEvent *ev = &e->xconfigure;
+
+  if (ev->window != root)
+    return;
+  display_width = ev->width;
+  display_height = ev->height;
+  /* with RandR the outputs are tracked by randrnotify */
+  if (randr_event_base < 0 && updategeom())
+    update_dirty_monitors();
+}
+
+void randrnotify(XEvent *e) {
+  XEvent ev;
+
+  XRRUpdateConfiguration(e);
+  /* one hotplug arrives as a burst of screen, crtc and output events */
+  while (XCheckTypedEvent(display, randr_event_base + RRScreenChangeNotify,
+                          &ev) ||
+         XCheckTypedEvent(display, randr_event_base + RRNotify, &ev))
+    XRRUpdateConfiguration(&ev);
+  if (updategeom())
+    update_dirty_monitors();
 }
 
 void configurerequest(XEvent *e) {
@@ -107,8 +132,9 @@ void configurerequest(XEvent *e) {
       if ((ev->value_mask & (CWX | CWY)) &&
           !(ev->value_mask & (CWWidth | CWHeight)))
         configure(c);
+      float_index_update(c);
       if (ISVISIBLE(c))
-        XMoveResizeWindow(display, c->win, c->x, c->y, c->w, c->h);
+        shadow_move_resize(c, c->x, c->y, c->w, c->h);
     } else
       configure(c);
   } else {
@@ -132,16 +158,21 @@ void destroynotify(XEvent *e) {
     unmanage(c, 1);
 }
 
-void enternotify(XEvent *e) {
+/* the last window the pointer entered while focus_dwell_ms runs */
+static Window entered;
+static int entered_x, entered_y;
+
+static void focus_window(Window w) {
   Client *c;
   Monitor *m;
-  XCrossingEvent *ev = &e->xcrossing;
 
-  if ((ev->mode != NotifyNormal || ev->detail == NotifyInferior) &&
-      ev->window != root)
-    return;
-  c = get_client_from_window(ev->window);
-  m = c ? c->mon : wintomon(ev->window);
+  c = get_client_from_window(w);
+  m = c ? c->mon : wintomon(w);
+  if ((w == m->sensor || w == m->bar_window) && m != selected_monitor &&
+      selected_monitor->game)
+    return; /* the pointer does not take focus off a game over the gaps */
+  if (m == selected_monitor && m->game)
+    return; /* no focus follows mouse on a monitor in game mode */
   if (m != selected_monitor) {
     unfocus(selected_monitor->selected_client, 1);
     selected_monitor = m;
@@ -150,6 +181,44 @@ void enternotify(XEvent *e) {
   focus(c);
 }
 
+void enternotify(XEvent *e) {
+  XCrossingEvent *ev = &e->xcrossing;
+
+  if ((ev->mode != NotifyNormal || ev->detail == NotifyInferior) &&
+      ev->window != root)
+    return;
+  if (!focus_dwell_ms) {
+    focus_window(ev->window);
+    return;
+  }
+  /* windows only passed over are replaced before the timer runs */
+  entered = ev->window;
+  entered_x = ev->x_root;
+  entered_y = ev->y_root;
+  timer_start(TimerFocus, focus_dwell_ms);
+}
+
+/* focuses the last entered window once the pointer settled, a pointer still
+ * moving faster than focus_sweep_px per dwell waits another dwell */
+void focus_entered(void) {
+  Window root_return, child;
+  int x, y, wx, wy, dx, dy;
+  unsigned int mask;
+
+  if (!XQueryPointer(display, root, &root_return, &child, &x, &y, &wx, &wy,
+                     &mask))
+    return;
+  dx = x - entered_x;
+  dy = y - entered_y;
+  if (dx * dx + dy * dy > focus_sweep_px * focus_sweep_px) {
+    entered_x = x;
+    entered_y = y;
+    timer_start(TimerFocus, focus_dwell_ms);
+    return;
+  }
+  focus_window(entered);
+}
+
 void expose(XEvent *e) {
   Monitor *m;
   XExposeEvent *ev = &e->xexpose;
@@ -168,10 +237,16 @@ void focusin(XEvent *e) {
 
 void mappingnotify(XEvent *e) {
   XMappingEvent *ev = &e->xmapping;
+  unsigned int old_numlockmask = numlockmask;
 
   XRefreshKeyboardMapping(ev);
-  if (ev->request == MappingKeyboard)
-    grabkeys();
+  if (ev->request != MappingKeyboard && ev->request != MappingModifier)
+    return;
+  /* numlockmask is only looked up here, grabkeys refreshes it; a keymap
+   * change can move NumLock as well */
+  grabkeys();
+  if (ev->request == MappingModifier || numlockmask != old_numlockmask)
+    regrab_buttons();
 }
 
 void maprequest(XEvent *e) {
@@ -184,21 +259,6 @@ void maprequest(XEvent *e) {
     setup_window(ev->window, &wa);
 }
 
-void motionnotify(XEvent *e) {
-  static Monitor *mon = NULL;
-  Monitor *m;
-  XMotionEvent *ev = &e->xmotion;
-
-  if (ev->window != root)
-    return;
-  if ((m = recttomon(ev->x_root, ev->y_root, 1, 1)) != mon && mon) {
-    unfocus(selected_monitor->selected_client, 1);
-    selected_monitor = m;
-    focus(NULL);
-  }
-  mon = m;
-}
-
 void propertynotify(XEvent *event) {
   Client *client;
   Window trans;
@@ -263,9 +323,13 @@ void unmapnotify(XEvent *e) {
   XUnmapEvent *ev = &e->xunmap;
 
   if ((c = get_client_from_window(ev->window))) {
-    if (ev->send_event)
+    if (ev->send_event && hidden_unmap && !c->isshown)
+      unmanage(c, 0); /* withdrawn while hidden, no real unmap follows */
+    else if (ev->send_event)
       setclientstate(c, WithdrawnState);
+    else if (c->ignoreunmap && ev->serial >= c->unmapserial)
+      c->ignoreunmap--; /* hidden by showhide, still managed */
     else
-      unmanage(c, 0);
+      unmanage(c, 0); /* unmapped by the client before we hid it */
   }
 }
@@ -10,6 +10,8 @@ void configurerequest(XEvent *e);
 void destroynotify(XEvent *e);
 void enternotify(XEvent *e);
 void expose(XEvent *e);
+void focus_entered(void);
 void focusin(XEvent *e);
+void randrnotify(XEvent *e);
 
 #endif
@@ -0,0 +1,230 @@
+#include "floating.h"
+
+#include "pwindow_manager.h"
+#include "config.h"
+#include "util.h"
+#include <stdlib.h>
+#include <string.h>
+
+/* one side of a client, at pos and spanning lo..hi on the other axis */
+typedef struct {
+  int pos, lo, hi;
+  Client *client;
+} Edge;
+
+typedef struct {
+  Edge *edges;
+  int length, size;
+} EdgeList;
+
+struct FloatIndex {
+  EdgeList vertical;   /* left and right sides, by x */
+  EdgeList horizontal; /* top and bottom sides, by y */
+  int widest;          /* no indexed client is wider, reset when empty */
+};
+
+/* positions tried per axis by place_floating besides the corner */
+#define PLACE_CANDIDATES 8
+
+/* first edge at or after pos */
+static int edge_lower_bound(EdgeList *l, int pos) {
+  int lo = 0, hi = l->length, mid;
+
+  while (lo < hi) {
+    mid = (lo + hi) / 2;
+    if (l->edges[mid].pos < pos)
+      lo = mid + 1;
+    else
+      hi = mid;
+  }
+  return lo;
+}
+
+static void edge_insert(EdgeList *l, int pos, int lo, int hi, Client *c) {
+  int i;
+
+  if (l->length == l->size) {
+    l->size = l->size ? l->size * 2 : 16;
+    if (!(l->edges = realloc(l->edges, l->size * sizeof(Edge))))
+      die("realloc:");
+  }
+  i = edge_lower_bound(l, pos);
+  memmove(&l->edges[i + 1], &l->edges[i], (l->length - i) * sizeof(Edge));
+  l->edges[i] = (Edge){pos, lo, hi, c};
+  l->length++;
+}
+
+static void edge_remove(EdgeList *l, int pos, Client *c) {
+  int i;
+
+  for (i = edge_lower_bound(l, pos); i < l->length && l->edges[i].pos == pos;
+       i++)
+    if (l->edges[i].client == c) {
+      memmove(&l->edges[i], &l->edges[i + 1],
+              (l->length - i - 1) * sizeof(Edge));
+      l->length--;
+      return;
+    }
+}
+
+void float_index_remove(Client *c) {
+  FloatIndex *f;
+
+  if (!c->indexmon)
+    return;
+  f = c->indexmon->floats;
+  edge_remove(&f->vertical, c->indexx, c);
+  edge_remove(&f->vertical, c->indexx + c->indexw, c);
+  edge_remove(&f->horizontal, c->indexy, c);
+  edge_remove(&f->horizontal, c->indexy + c->indexh, c);
+  if (!f->vertical.length)
+    f->widest = 0;
+  c->indexmon = NULL;
+}
+
+void float_index_update(Client *c) {
+  FloatIndex *f;
+
+  if (c->indexmon == c->mon && c->indexx == c->x && c->indexy == c->y &&
+      c->indexw == WIDTH(c) && c->indexh == HEIGHT(c) && c->isfloating &&
+      !c->isfullscreen)
+    return;
+  float_index_remove(c);
+  if (!c->isfloating || c->isfullscreen)
+    return;
+  if (!c->mon->floats)
+    c->mon->floats = ecalloc(1, sizeof(FloatIndex));
+  f = c->mon->floats;
+  c->indexmon = c->mon;
+  c->indexx = c->x;
+  c->indexy = c->y;
+  c->indexw = WIDTH(c);
+  c->indexh = HEIGHT(c);
+  f->widest = MAX(f->widest, c->indexw);
+  edge_insert(&f->vertical, c->x, c->y, c->y + c->indexh, c);
+  edge_insert(&f->vertical, c->x + c->indexw, c->y, c->y + c->indexh, c);
+  edge_insert(&f->horizontal, c->y, c->x, c->x + c->indexw, c);
+  edge_insert(&f->horizontal, c->y + c->indexh, c->x, c->x + c->indexw, c);
+}
+
+void float_index_free(Monitor *m) {
+  if (!m->floats)
+    return;
+  free(m->floats->vertical.edges);
+  free(m->floats->horizontal.edges);
+  free(m->floats);
+  m->floats = NULL;
+}
+
+/* the edge of another visible floating client within snap of pos whose span
+ * meets lo..hi, returns the offset to it or snap when there is none */
+static int nearest_edge(Monitor *m, EdgeList *l, Client *self, int pos, int lo,
+                        int hi) {
+  int i, d, best = snap, range = snap;
+  Edge *e;
+
+  for (i = edge_lower_bound(l, pos - range + 1);
+       i < l->length && l->edges[i].pos < pos + range; i++) {
+    e = &l->edges[i];
+    if (e->client == self || e->client->mon != m || !ISVISIBLE(e->client) ||
+        !e->client->isfloating || e->client->isfullscreen || e->lo >= hi ||
+        e->hi <= lo)
+      continue;
+    d = e->pos - pos;
+    if (abs(d) < abs(best))
+      best = d;
+  }
+  return best;
+}
+
+/* moves *x and *y onto the sides of other floating clients within snap */
+void snap_to_floating(Client *c, int *x, int *y) {
+  Monitor *m = c->mon;
+  int d, none = snap, w = WIDTH(c), h = HEIGHT(c);
+
+  if (!snap_windows || !m->floats)
+    return;
+  if ((d = nearest_edge(m, &m->floats->vertical, c, *x, *y, *y + h)) == none)
+    d = nearest_edge(m, &m->floats->vertical, c, *x + w, *y, *y + h);
+  if (d != none)
+    *x += d;
+  if ((d = nearest_edge(m, &m->floats->horizontal, c, *y, *x, *x + w)) == none)
+    d = nearest_edge(m, &m->floats->horizontal, c, *y + h, *x, *x + w);
+  if (d != none)
+    *y += d;
+}
+
+static int is_placed_over(Monitor *m, Client *self, Client *o) {
+  return o != self && o->mon == m && ISVISIBLE(o) && o->isfloating &&
+         !o->isfullscreen;
+}
+
+/* area of x, y, w, h covered by the visible floating clients of m; only
+ * clients whose left side lies within widest of the area can meet it */
+static long overlap(Monitor *m, Client *self, int x, int y, int w, int h) {
+  FloatIndex *f = m->floats;
+  EdgeList *l = &f->vertical;
+  Client *o;
+  long area = 0;
+  int i, ow, oh;
+
+  for (i = edge_lower_bound(l, x - f->widest + 1);
+       i < l->length && l->edges[i].pos < x + w; i++) {
+    o = l->edges[i].client;
+    if (l->edges[i].pos != o->indexx || !is_placed_over(m, self, o))
+      continue;
+    ow = MIN(x + w, o->indexx + o->indexw) - MAX(x, o->indexx);
+    oh = MIN(y + h, o->indexy + o->indexh) - MAX(y, o->indexy);
+    if (ow > 0 && oh > 0)
+      area += (long)ow * oh;
+  }
+  return area;
+}
+
+/* fills out with lo and the first PLACE_CANDIDATES distinct right (or
+ * bottom) sides after it that leave room for size before hi */
+static int candidates(Monitor *m, Client *self, EdgeList *l, int vertical,
+                      int lo, int hi, int size, int *out) {
+  Edge *e;
+  int i, n = 0;
+
+  out[n++] = lo;
+  for (i = edge_lower_bound(l, lo + 1);
+       i < l->length && n <= PLACE_CANDIDATES; i++) {
+    e = &l->edges[i];
+    if (e->pos + size > hi)
+      break;
+    if (e->pos == (vertical ? e->client->indexx : e->client->indexy) ||
+        e->pos == out[n - 1] || !is_placed_over(m, self, e->client))
+      continue;
+    out[n++] = e->pos;
+  }
+  return n;
+}
+
+/* puts c where it covers the least of the other floating clients, trying
+ * the window area corner and the right and bottom sides nearest to it */
+void place_floating(Client *c) {
+  Monitor *m = c->mon;
+  int xs[PLACE_CANDIDATES + 1], ys[PLACE_CANDIDATES + 1];
+  int i, j, nx, ny, w = WIDTH(c), h = HEIGHT(c);
+  long area, best = -1;
+
+  c->x = m->window_area_x;
+  c->y = m->window_area_y;
+  if (!m->floats)
+    return;
+  nx = candidates(m, c, &m->floats->vertical, 1, m->window_area_x,
+                  m->window_area_x + m->window_area_width, w, xs);
+  ny = candidates(m, c, &m->floats->horizontal, 0, m->window_area_y,
+                  m->window_area_y + m->window_area_height, h, ys);
+  for (j = 0; j < ny && best; j++)
+    for (i = 0; i < nx && best; i++) {
+      area = overlap(m, c, xs[i], ys[j], w, h);
+      if (best < 0 || area < best) {
+        best = area;
+        c->x = xs[i];
+        c->y = ys[j];
+      }
+    }
+}
@@ -0,0 +1,15 @@
+#ifndef FLOATING_H
+#define FLOATING_H
+
+#include "types.h"
+
+/* per monitor index of the edges of floating clients, sorted by position,
+ * kept up to date by resizeclient */
+void float_index_update(Client *c);
+void float_index_remove(Client *c);
+void float_index_free(Monitor *m);
+
+void snap_to_floating(Client *c, int *x, int *y);
+void place_floating(Client *c);
+
+#endif
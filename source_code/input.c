@@ -5,7 +5,19 @@
 #include "pwindow_manager.h"
 #include "types.h"
 #include "windows.h"
+#include "shadow.h"
+#include "floating.h"
+#include "util.h"
 #include <X11/Xlib.h>
+#include <X11/XKBlib.h>
+#include <X11/extensions/shape.h>
+#include <X11/extensions/sync.h>
+#include <X11/Xatom.h>
+#include <poll.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
 
 #include "draw.h"
 
@@ -22,18 +34,32 @@ void (*handler[LASTEvent])(XEvent *) = {[ButtonPress] = mouse_button_press,
                                         [KeyPress] = keypress,
                                         [MappingNotify] = mappingnotify,
                                         [MapRequest] = maprequest,
-                                        [MotionNotify] = motionnotify,
                                         [PropertyNotify] = propertynotify,
                                         [UnmapNotify] = unmapnotify};
 
+static long long local_ms(void) {
+  struct timespec now;
+
+  clock_gettime(CLOCK_MONOTONIC, &now);
+  return now.tv_sec * 1000LL + now.tv_nsec / 1000000;
+}
+
 void mouse_button_press(XEvent *event) {
   unsigned int i, x, click;
+  long long start = local_ms(), replayed = 0;
   Arg arg = {0};
   Client *client;
   Monitor *monitor;
   XButtonPressedEvent *buttons_pressed_event = &event->xbutton;
 
   click = ClkRootWin;
+  /* the unfocused grab froze the pointer, hand the click on to the client
+   * before the focus work instead of after it */
+  if ((client = get_client_from_window(buttons_pressed_event->window))) {
+    XAllowEvents(display, ReplayPointer, CurrentTime);
+    XFlush(display);
+    replayed = local_ms();
+  }
   /* focus monitor if necessary */
   if ((monitor = wintomon(buttons_pressed_event->window)) &&
       monitor != selected_monitor) {
@@ -59,11 +85,15 @@ void mouse_button_press(XEvent *event) {
       click = ClkStatusText;
     else
       click = ClkWinTitle;
-  } else if ((client = get_client_from_window(buttons_pressed_event->window))) {
+  } else if (client) {
     focus(client);
     restack(selected_monitor);
-    XAllowEvents(display, ReplayPointer, CurrentTime);
     click = ClkClientWin;
+    if (report_click_latency)
+      fprintf(stderr,
+              "pwindow_manager: click replayed after %lld ms, "
+              "focus and restack took %lld ms more\n",
+              replayed - start, local_ms() - replayed);
   }
   for (i = 0; i < LENGTH(buttons); i++)
     if (click == buttons[i].click && buttons[i].func &&
@@ -73,17 +103,440 @@ void mouse_button_press(XEvent *event) {
           click == ClkTagBar && buttons[i].arg.i == 0 ? &arg : &buttons[i].arg);
 }
 
+/* keys[] and every submap indexed by (keycode, clean modifiers), built
+ * by grabkeys from the current keyboard mapping */
+#define BINDING_BUCKETS 256
+
+typedef struct Binding Binding;
+struct Binding {
+  unsigned int keycode, mod;
+  const Key *key;
+  Binding *next;
+};
+
+typedef struct {
+  Binding *buckets[BINDING_BUCKETS];
+  Binding *bindings;
+} KeyTable;
+
+typedef struct {
+  KeySym sym;
+  KeyCode code;
+} SymCode;
+
+static KeyTable main_table, submap_tables[LENGTH(submaps)];
+static KeyTable *active_table = &main_table;
+static const Submap *active_submap;
+
+static unsigned int binding_hash(unsigned int keycode, unsigned int mod) {
+  return (keycode + mod * 131) % BINDING_BUCKETS;
+}
+
+static int compare_symcode(const void *a, const void *b) {
+  const SymCode *x = a, *y = b;
+
+  return x->sym < y->sym ? -1 : x->sym > y->sym;
+}
+
+/* first of the keycodes producing sym, codes is sorted by keysym */
+static int first_keycode(const SymCode *codes, int n, KeySym sym) {
+  int lo = 0, hi = n, mid;
+
+  while (lo < hi) {
+    mid = (lo + hi) / 2;
+    if (codes[mid].sym < sym)
+      lo = mid + 1;
+    else
+      hi = mid;
+  }
+  return lo;
+}
+
+static void build_table(KeyTable *t, const Key *keys, unsigned int length,
+                        const SymCode *codes, int ncodes) {
+  Binding *b, **tail;
+  unsigned int i, n = 0;
+  int j;
+
+  for (i = 0; i < length; i++)
+    for (j = first_keycode(codes, ncodes, keys[i].keysym);
+         j < ncodes && codes[j].sym == keys[i].keysym; j++)
+      n++;
+  free(t->bindings);
+  memset(t->buckets, 0, sizeof t->buckets);
+  t->bindings = ecalloc(MAX(n, 1), sizeof(Binding));
+  for (b = t->bindings, i = 0; i < length; i++)
+    for (j = first_keycode(codes, ncodes, keys[i].keysym);
+         j < ncodes && codes[j].sym == keys[i].keysym; j++, b++) {
+      b->keycode = codes[j].code;
+      b->mod = CLEANMASK(keys[i].mod);
+      b->key = &keys[i];
+      /* keep the order of keys[], all bindings of a combination run */
+      for (tail = &t->buckets[binding_hash(b->keycode, b->mod)]; *tail;
+           tail = &(*tail)->next)
+        ;
+      *tail = b;
+    }
+}
+
+static int compare_grab(const void *a, const void *b) {
+  unsigned long x = *(const unsigned long *)a, y = *(const unsigned long *)b;
+
+  return x < y ? -1 : x > y;
+}
+
+typedef struct {
+  XKeyEvent *first;
+  int stopped; /* another key is queued, nothing after it is merged */
+} RepeatScan;
+
+static Bool is_same_key(Display *dpy, XEvent *ev, XPointer arg) {
+  RepeatScan *scan = (RepeatScan *)arg;
+
+  if (scan->stopped || (ev->type != KeyPress && ev->type != KeyRelease))
+    return False;
+  if (ev->xkey.keycode == scan->first->keycode &&
+      CLEANMASK(ev->xkey.state) == CLEANMASK(scan->first->state))
+    return True;
+  scan->stopped = 1;
+  return False;
+}
+
+/* moveresize style bindings take deltas: the autorepeats of the key queued
+ * before any other key are folded into one call, and the deltas grow while it is held */
+static void repeat_moveresize(const Key *key, XKeyEvent *ev) {
+  static unsigned int held;
+  static Time start, last;
+  const int *delta = key->arg.v;
+  int i, v[4], presses = 1;
+  float steps;
+  Arg arg = {.v = v};
+  XEvent next;
+  RepeatScan scan = {.first = ev};
+
+  while (XCheckIfEvent(display, &next, is_same_key, (XPointer)&scan))
+    if (next.type == KeyPress) {
+      presses++;
+      ev->time = next.xkey.time;
+    }
+  if (ev->keycode != held || ev->time - last > repeat_hold_ms) {
+    held = ev->keycode;
+    start = ev->time;
+  }
+  last = ev->time;
+  steps = presses * MIN(1 + repeat_accel * (ev->time - start) / 1000.0f,
+                        repeat_accel_max);
+  for (i = 0; i < 4; i++)
+    v[i] = delta[i] * steps;
+  key->func(&arg);
+}
+
 void keypress(XEvent *e) {
-  unsigned int i;
-  KeySym keysym;
-  XKeyEvent *ev;
+  XKeyEvent *ev = &e->xkey;
+  const Submap *submap = active_submap;
+  unsigned int mod = CLEANMASK(ev->state);
+  Binding *b;
+  int found = 0;
+
+  for (b = active_table->buckets[binding_hash(ev->keycode, mod)]; b;
+       b = b->next) {
+    if (b->keycode != ev->keycode || b->mod != mod || !b->key->func)
+      continue;
+    found = 1;
+    if ((b->key->func == moveresize || b->key->func == moveresizewebcam) &&
+        b->key->arg.v)
+      repeat_moveresize(b->key, ev);
+    else
+      b->key->func(&b->key->arg);
+  }
+  /* a chord ends with the first key that is not a modifier */
+  if (submap && submap == active_submap && submap->oneshot &&
+      (found || !IsModifierKey(XkbKeycodeToKeysym(display, ev->keycode, 0, 0))))
+    leave_submap(NULL);
+}
+
+/* the keyboard is grabbed while a submap is active, its keys need no
+ * modifier */
+void enter_submap(const Arg *arg) {
+  const Submap *submap = arg->v;
+
+  if (XGrabKeyboard(display, root, True, GrabModeAsync, GrabModeAsync,
+                    CurrentTime) != GrabSuccess)
+    return;
+  active_submap = submap;
+  active_table = &submap_tables[submap - submaps];
+}
+
+void leave_submap(const Arg *arg) {
+  if (!active_submap)
+    return;
+  XUngrabKeyboard(display, CurrentTime);
+  active_submap = NULL;
+  active_table = &main_table;
+}
+
+/* state of a mouse drag: motion is compressed to the newest position and
+ * applied at most once per refresh of the monitor under the pointer */
+typedef struct {
+  Time last;       /* server time of the last applied motion */
+  long long skew;  /* server minus local clock, from the least delayed event */
+  int updates, coalesced;
+  double total, worst; /* pointer to configure latency, ms */
+  int pending, x, y, w, h; /* geometry the client has not got yet */
+  long long applied;       /* local time the client was last configured */
+  XSyncCounter counter;    /* _NET_WM_SYNC_REQUEST_COUNTER of the client */
+  XSyncAlarm alarm;        /* fires when the client painted the last size */
+  XSyncValue value;        /* last value asked for */
+  int awaiting;            /* a sync request is unanswered */
+  long long requested;     /* local time of that request */
+} Drag;
+
+int sync_event_base = -1;
+
+static Window outline;
+static int outline_w, outline_h;
+
+/* motion queued before the first ButtonRelease, arg is set once it is seen */
+static Bool is_motion_before_release(Display *dpy, XEvent *ev, XPointer arg) {
+  int *released = (int *)arg;
+
+  if (ev->type == ButtonRelease)
+    *released = 1;
+  return !*released && ev->type == MotionNotify;
+}
+
+/* replaces ev with the newest motion queued before the button is released,
+ * counting the ones dropped */
+static void drain_motion(Drag *drag, XEvent *ev) {
+  int released = 0;
+
+  while (XCheckIfEvent(display, ev, is_motion_before_release,
+                       (XPointer)&released))
+    drag->coalesced++;
+}
+
+/* waits until the next refresh is due, then takes the newest motion */
+static void pace_motion(Drag *drag, XEvent *ev) {
+  struct pollfd connection = {.fd = ConnectionNumber(display),
+                              .events = POLLIN};
+  Monitor *m = pointtomon(ev->xmotion.x_root, ev->xmotion.y_root);
+  double interval = 1000.0 / (m->refresh_rate > 0 ? m->refresh_rate : 60);
+  double wait;
+  long long skew;
+
+  drain_motion(drag, ev);
+  if (drag->last &&
+      (wait = interval - (double)(ev->xmotion.time - drag->last)) >= 1) {
+    poll(&connection, 1, (int)wait);
+    drain_motion(drag, ev);
+  }
+  drag->last = ev->xmotion.time;
+  skew = (long long)ev->xmotion.time - local_ms();
+  if (!drag->updates || skew > drag->skew)
+    drag->skew = skew;
+}
+
+/* ev has been configured, resizeclient waits for the server */
+static void motion_applied(Drag *drag, XEvent *ev) {
+  double latency = local_ms() + drag->skew - (long long)ev->xmotion.time;
 
-  ev = &e->xkey;
-  keysym = XKeycodeToKeysym(display, (KeyCode)ev->keycode, 0);
-  for (i = 0; i < LENGTH(keys); i++)
-    if (keysym == keys[i].keysym &&
-        CLEANMASK(keys[i].mod) == CLEANMASK(ev->state) && keys[i].func)
-      keys[i].func(&(keys[i].arg));
+  drag->updates++;
+  drag->total += latency;
+  drag->worst = MAX(drag->worst, latency);
+}
+
+/* a frame of borderpx around the outer geometry, shaped so only the ring
+ * is drawn; reshaped only when the size changes */
+static void show_outline(int x, int y, int w, int h) {
+  XSetWindowAttributes wa = {
+      .override_redirect = True,
+      .background_pixel = color_scheme[SchemeSelected][ColBorder].pixel};
+  int b = MAX(borderpx, 1);
+
+  if (!outline)
+    outline = XCreateWindow(display, root, x, y, w, h, 0,
+                            DefaultDepth(display, screen), CopyFromParent,
+                            DefaultVisual(display, screen),
+                            CWOverrideRedirect | CWBackPixel, &wa);
+  if (w != outline_w || h != outline_h) {
+    XRectangle ring[] = {
+        {0, 0, w, b}, {0, h - b, w, b}, {0, 0, b, h}, {w - b, 0, b, h}};
+
+    XMoveResizeWindow(display, outline, x, y, w, h);
+    XShapeCombineRectangles(display, outline, ShapeBounding, 0, 0, ring,
+                            LENGTH(ring), ShapeSet, Unsorted);
+    XShapeCombineRectangles(display, outline, ShapeInput, 0, 0, NULL, 0,
+                            ShapeSet, Unsorted);
+    outline_w = w;
+    outline_h = h;
+  } else
+    XMoveWindow(display, outline, x, y);
+  XMapRaised(display, outline);
+}
+
+void setup_sync(void) {
+  int error_base, major, minor;
+
+  if (!XSyncQueryExtension(display, &sync_event_base, &error_base) ||
+      !XSyncInitialize(display, &major, &minor))
+    sync_event_base = -1;
+}
+
+/* the counter of a client speaking _NET_WM_SYNC_REQUEST, None otherwise */
+static XSyncCounter sync_counter(Client *c) {
+  int format, n, supported = 0;
+  unsigned long items, extra;
+  unsigned char *p = NULL;
+  Atom *protocols, real;
+  XSyncCounter counter = None;
+
+  if (XGetWMProtocols(display, c->win, &protocols, &n)) {
+    while (!supported && n--)
+      supported = protocols[n] == netatom[NetWMSyncRequest];
+    XFree(protocols);
+  }
+  if (supported &&
+      XGetWindowProperty(display, c->win, netatom[NetWMSyncRequestCounter], 0L,
+                         1L, False, XA_CARDINAL, &real, &format, &items,
+                         &extra, &p) == Success &&
+      p) {
+    if (items)
+      counter = *(long *)p;
+    XFree(p);
+  }
+  return counter;
+}
+
+/* resizes of c wait for it to paint the previous size when it can say so */
+static void sync_begin(Drag *drag, Client *c) {
+  XSyncAlarmAttributes aa;
+
+  if (!sync_resize || sync_event_base < 0 ||
+      !(drag->counter = sync_counter(c)) ||
+      !XSyncQueryCounter(display, drag->counter, &drag->value))
+    return;
+  aa.trigger.counter = drag->counter;
+  aa.trigger.value_type = XSyncAbsolute;
+  aa.trigger.wait_value = drag->value;
+  aa.trigger.test_type = XSyncPositiveComparison;
+  XSyncIntToValue(&aa.delta, 1);
+  aa.events = True;
+  drag->alarm = XSyncCreateAlarm(display,
+                                 XSyncCACounter | XSyncCAValueType |
+                                     XSyncCAValue | XSyncCATestType |
+                                     XSyncCADelta | XSyncCAEvents,
+                                 &aa);
+}
+
+static void sync_request(Drag *drag, Client *c) {
+  XSyncAlarmAttributes aa;
+  XSyncValue one;
+  XEvent ev = {.type = ClientMessage};
+  int overflow;
+
+  XSyncIntToValue(&one, 1);
+  XSyncValueAdd(&drag->value, drag->value, one, &overflow);
+  ev.xclient.window = c->win;
+  ev.xclient.message_type = wmatom[WMProtocols];
+  ev.xclient.format = 32;
+  ev.xclient.data.l[0] = netatom[NetWMSyncRequest];
+  ev.xclient.data.l[1] = CurrentTime;
+  ev.xclient.data.l[2] = XSyncValueLow32(drag->value);
+  ev.xclient.data.l[3] = XSyncValueHigh32(drag->value);
+  XSendEvent(display, c->win, False, NoEventMask, &ev);
+  aa.trigger.wait_value = drag->value;
+  XSyncChangeAlarm(display, drag->alarm, XSyncCAValue, &aa);
+  drag->awaiting = 1;
+  drag->requested = local_ms();
+}
+
+/* configures c with the newest geometry of the drag */
+static void apply_drag(Drag *drag, Client *c) {
+  if (!drag->pending)
+    return;
+  if (drag->alarm && (drag->w != c->w || drag->h != c->h))
+    sync_request(drag, c);
+  resizeclient(c, drag->x, drag->y, drag->w, drag->h);
+  drag->applied = local_ms();
+  drag->pending = 0;
+}
+
+/* the client painted the size it was asked for, or took too long */
+static void sync_done(Drag *drag, Client *c) {
+  drag->awaiting = 0;
+  apply_drag(drag, c);
+}
+
+static Bool is_drag_event(Display *dpy, XEvent *ev, XPointer arg) {
+  switch (ev->type) {
+  case ButtonPress:
+  case ButtonRelease:
+  case MotionNotify:
+  case Expose:
+  case ConfigureRequest:
+  case MapRequest:
+    return True;
+  }
+  return sync_event_base >= 0 &&
+         ev->type == sync_event_base + XSyncAlarmNotify &&
+         ((XSyncAlarmNotifyEvent *)ev)->alarm == ((Drag *)arg)->alarm;
+}
+
+/* next event of a drag, 0 when the sync request timed out first */
+static int next_drag_event(Drag *drag, XEvent *ev) {
+  struct pollfd connection = {.fd = ConnectionNumber(display),
+                              .events = POLLIN};
+  long long wait;
+
+  while (!XCheckIfEvent(display, ev, is_drag_event, (XPointer)drag)) {
+    wait = -1;
+    if (drag->awaiting &&
+        (wait = sync_timeout - (local_ms() - drag->requested)) <= 0)
+      return 0;
+    poll(&connection, 1, (int)wait);
+  }
+  return 1;
+}
+
+/* opaque drags configure the client on every update unless it is still
+ * painting the previous size, outline drags move the outline and configure
+ * the client on release or every outline_apply_ms */
+static void drag_resize(Drag *drag, Client *c, int x, int y, int w, int h) {
+  if (!outline_drag && !drag->alarm) {
+    resize(c, x, y, w, h, 1);
+    return;
+  }
+  applysizehints(c, &x, &y, &w, &h, 1);
+  drag->pending = 1;
+  drag->x = x;
+  drag->y = y;
+  drag->w = w;
+  drag->h = h;
+  if (outline_drag) {
+    show_outline(x, y, w + 2 * c->border_width, h + 2 * c->border_width);
+    if (!outline_apply_ms || local_ms() - drag->applied < outline_apply_ms)
+      return;
+  }
+  if (!drag->awaiting)
+    apply_drag(drag, c);
+}
+
+static void drag_finish(Drag *drag, Client *c) {
+  if (outline_drag)
+    XUnmapWindow(display, outline);
+  apply_drag(drag, c);
+  if (drag->alarm)
+    XSyncDestroyAlarm(display, drag->alarm);
+}
+
+static void report_drag(Drag *drag, const char *what) {
+  if (!report_drag_latency || !drag->updates)
+    return;
+  fprintf(stderr,
+          "pwindow_manager: %s %d updates, %d motion events coalesced, "
+          "latency %.1f ms average %.1f ms worst\n",
+          what, drag->updates, drag->coalesced, drag->total / drag->updates,
+          drag->worst);
 }
 
 void move_mouse(const Arg *arg) {
@@ -91,7 +544,7 @@ void move_mouse(const Arg *arg) {
   Client *client;
   Monitor *monitor;
   XEvent event;
-  Time lasttime = 0;
+  Drag drag = {0};
 
   if (!(client = selected_monitor->selected_client))
     return;
@@ -123,10 +576,7 @@ void move_mouse(const Arg *arg) {
       handler[event.type](&event);
       break;
     case MotionNotify:
-      if ((event.xmotion.time - lasttime) <= (1000 / 60))
-        continue;
-      lasttime = event.xmotion.time;
-
+      pace_motion(&drag, &event);
       nx = out_client_x + (event.xmotion.x - x);
       ny = out_client_y + (event.xmotion.y - y);
       if (abs(selected_monitor->window_area_x - nx) < snap)
@@ -143,18 +593,22 @@ void move_mouse(const Arg *arg) {
                    (ny + HEIGHT(client))) < snap)
         ny = selected_monitor->window_area_y +
              selected_monitor->window_area_height - HEIGHT(client);
+      snap_to_floating(client, &nx, &ny);
       if (!client->isfloating &&
           selected_monitor->lt[selected_monitor->sellt]->arrange &&
           (abs(nx - client->x) > snap || abs(ny - client->y) > snap))
         togglefloating(NULL);
       if (!selected_monitor->lt[selected_monitor->sellt]->arrange ||
           client->isfloating)
-        resize(client, nx, ny, client->w, client->h, 1);
+        drag_resize(&drag, client, nx, ny, client->w, client->h);
+      motion_applied(&drag, &event);
       break;
     }
   } while (event.type != ButtonRelease);
 
   XUngrabPointer(display, CurrentTime);
+  drag_finish(&drag, client);
+  report_drag(&drag, "move");
 
   if ((monitor = recttomon(client->x, client->y, client->w, client->h)) !=
       selected_monitor) {
@@ -169,7 +623,7 @@ void resize_with_mouse(const Arg *arg) {
   Client *client;
   Monitor *monitor;
   XEvent event;
-  Time lasttime = 0;
+  Drag drag = {0};
 
   if (!(client = selected_monitor->selected_client))
     return;
@@ -188,9 +642,17 @@ void resize_with_mouse(const Arg *arg) {
   XWarpPointer(display, None, client->win, 0, 0, 0, 0,
                client->w + client->border_width - 1,
                client->h + client->border_width - 1);
+  sync_begin(&drag, client);
   do {
-    XMaskEvent(display, MOUSEMASK | ExposureMask | SubstructureRedirectMask,
-               &event);
+    if (!next_drag_event(&drag, &event)) {
+      sync_done(&drag, client);
+      continue;
+    }
+    if (sync_event_base >= 0 &&
+        event.type == sync_event_base + XSyncAlarmNotify) {
+      sync_done(&drag, client);
+      continue;
+    }
     switch (event.type) {
     case ConfigureRequest:
     case Expose:
@@ -198,10 +660,7 @@ void resize_with_mouse(const Arg *arg) {
       handler[event.type](&event);
       break;
     case MotionNotify:
-      if ((event.xmotion.time - lasttime) <= (1000 / 60))
-        continue;
-      lasttime = event.xmotion.time;
-
+      pace_motion(&drag, &event);
       new_width =
           MAX(event.xmotion.x - out_client_x - 2 * client->border_width + 1, 1);
       new_height =
@@ -224,10 +683,14 @@ void resize_with_mouse(const Arg *arg) {
       }
       if (!selected_monitor->lt[selected_monitor->sellt]->arrange ||
           client->isfloating)
-        resize(client, client->x, client->y, new_width, new_height, 1);
+        drag_resize(&drag, client, client->x, client->y, new_width,
+                    new_height);
+      motion_applied(&drag, &event);
       break;
     }
   } while (event.type != ButtonRelease);
+  drag_finish(&drag, client);
+  report_drag(&drag, "resize");
   XWarpPointer(display, None, client->win, 0, 0, 0, 0,
                client->w + client->border_width - 1,
                client->h + client->border_width - 1);
@@ -242,33 +705,71 @@ void resize_with_mouse(const Arg *arg) {
   }
 }
 
+/* the modifier map changed, numlockmask with it: every client gets its
+ * button grabs again */
+void regrab_buttons(void) {
+  Monitor *lists[] = {monitors, parked_monitors};
+  Monitor *m;
+  Client *c;
+  size_t i;
+
+  for (i = 0; i < LENGTH(lists); i++)
+    for (m = lists[i]; m; m = m->next)
+      for (c = m->clients; c; c = c->next) {
+        shadow_forget_grab(c);
+        grabbuttons(c, c == selected_monitor->selected_client);
+      }
+}
+
+/* rebuilds the key tables and grabs each combination of keys[] once */
 void grabkeys(void) {
+  unsigned int i, j, modifiers[4];
+  unsigned long *grabs;
+  int start, end, k, ncodes = 0, ngrabs = 0;
+  SymCode *codes;
+  Binding *b;
+
   updatenumlockmask();
-  {
-    unsigned int i, j, k;
-    unsigned int modifiers[] = {0, LockMask, numlockmask,
-                                numlockmask | LockMask};
-    int start, end, skip;
-    KeySym *syms;
+  modifiers[0] = 0;
+  modifiers[1] = LockMask;
+  modifiers[2] = numlockmask;
+  modifiers[3] = numlockmask | LockMask;
 
-    XUngrabKey(display, AnyKey, AnyModifier, root);
-    XDisplayKeycodes(display, &start, &end);
-    syms = XGetKeyboardMapping(display, start, end - start + 1, &skip);
-    if (!syms)
-      return;
-    for (k = start; k <= end; k++)
-      for (i = 0; i < LENGTH(keys); i++)
-        /* skip modifier codes, we do that ourselves */
-        if (keys[i].keysym == syms[(k - start) * skip])
-          for (j = 0; j < LENGTH(modifiers); j++)
-            XGrabKey(display, k, keys[i].mod | modifiers[j], root, True,
-                     GrabModeAsync, GrabModeAsync);
-    XFree(syms);
-  }
+  XDisplayKeycodes(display, &start, &end);
+  codes = ecalloc(end - start + 1, sizeof(SymCode));
+  for (k = start; k <= end; k++)
+    if ((codes[ncodes].sym = XkbKeycodeToKeysym(display, k, 0, 0)) !=
+        NoSymbol)
+      codes[ncodes++].code = k;
+  qsort(codes, ncodes, sizeof(SymCode), compare_symcode);
+  build_table(&main_table, keys, LENGTH(keys), codes, ncodes);
+  for (i = 0; i < LENGTH(submaps); i++)
+    build_table(&submap_tables[i], submaps[i].keys, submaps[i].length, codes,
+                ncodes);
+  free(codes);
+
+  for (i = 0; i < BINDING_BUCKETS; i++)
+    for (b = main_table.buckets[i]; b; b = b->next)
+      ngrabs += LENGTH(modifiers);
+  grabs = ecalloc(MAX(ngrabs, 1), sizeof(unsigned long));
+  for (ngrabs = 0, i = 0; i < BINDING_BUCKETS; i++)
+    for (b = main_table.buckets[i]; b; b = b->next)
+      for (j = 0; j < LENGTH(modifiers); j++)
+        grabs[ngrabs++] = (unsigned long)b->keycode << 16 |
+                          (b->key->mod | modifiers[j]);
+  qsort(grabs, ngrabs, sizeof(unsigned long), compare_grab);
+
+  XUngrabKey(display, AnyKey, AnyModifier, root);
+  for (k = 0; k < ngrabs; k++)
+    if (!k || grabs[k] != grabs[k - 1])
+      XGrabKey(display, grabs[k] >> 16, grabs[k] & 0xffff, root, True,
+               GrabModeAsync, GrabModeAsync);
+  free(grabs);
 }
 
 void grabbuttons(Client *c, int focused) {
-  updatenumlockmask();
+  if (!shadow_grab_buttons(c, focused))
+    return;
   {
     unsigned int i, j;
     unsigned int modifiers[] = {0, LockMask, numlockmask,
@@ -13,4 +13,9 @@ void move_mouse(const Arg *arg);
 
 void resize_with_mouse(const Arg *arg);
 
+void setup_sync(void);
+
+void enter_submap(const Arg *arg);
+void leave_submap(const Arg *arg);
+
 #endif
@@ -25,8 +25,11 @@
 #include <X11/Xproto.h>
 #include <X11/Xutil.h>
 #include <X11/cursorfont.h>
+#include <X11/extensions/Xrandr.h>
 #include <X11/keysym.h>
+#include <errno.h>
 #include <locale.h>
+#include <poll.h>
 #include <signal.h>
 #include <stdio.h>
 #include <stdlib.h>
@@ -49,6 +52,10 @@
 #include "windows.h"
 #include "events.h"
 #include "bar.h"
+#include "shadow.h"
+#include "floating.h"
+#include "timer.h"
+#include "schedule.h"
 
 
 char stext[256];
@@ -62,7 +69,7 @@ int display_width, display_height; /* X display screen geometry width, height */
 static int running = 1;
 
 Atom wmatom[WMLast], netatom[NetLast];
-Monitor *monitors, *selected_monitor;
+Monitor *monitors, *selected_monitor, *parked_monitors;
 Display *display;
 Window root, wmcheckwin;
 Color **color_scheme;
@@ -116,6 +123,7 @@ void applyrules(Client *c) {
 
   /* rule matching */
   c->isfloating = 0;
+  c->isgame = 0;
   c->tags = 0;
   XGetClassHint(display, c->win, &ch);
   class = ch.res_class ? ch.res_class : broken;
@@ -127,10 +135,9 @@ void applyrules(Client *c) {
         (!r->class || strstr(class, r->class)) &&
         (!r->instance || strstr(instance, r->instance))) {
       c->isfloating = r->isfloating;
+      c->isgame = r->isgame;
       c->tags |= r->tags;
-      for (m = monitors; m && m->num != r->monitor; m = m->next)
-        ;
-      if (m)
+      if (r->monitor >= 0 && (m = numtomon(r->monitor))->num == r->monitor)
         c->mon = m;
     }
   }
@@ -158,6 +165,7 @@ void cleanup(void) {
   Monitor *m;
   size_t i;
 
+  adopt_all_parked_clients();
   view(&a);
   selected_monitor->lt[selected_monitor->sellt] = &foo;
   for (m = monitors; m; m = m->next)
@@ -166,6 +174,8 @@ void cleanup(void) {
   XUngrabKey(display, AnyKey, AnyModifier, root);
   while (monitors)
     clean_up_monitors(monitors);
+  while (parked_monitors)
+    clean_up_monitors(parked_monitors);
   for (i = 0; i < CurLast; i++)
     drw_cur_free(drw, cursor[i]);
   for (i = 0; i < LENGTH(colors); i++)
@@ -240,23 +250,35 @@ int gettextprop(Window w, Atom atom, char *text, unsigned int size) {
 
 void incnmaster(const Arg *arg) {
   selected_monitor->nmaster = MAX(selected_monitor->nmaster + arg->i, 0);
+  save_tag_layout(selected_monitor);
   arrange(selected_monitor);
 }
 
 
+/* only the client on top is sized right away, the ones behind it are
+ * deferred until focus brings them up */
 void monocle(Monitor *m) {
   unsigned int n = 0;
-  Client *c;
+  Client *c, *top, *next = NULL;
 
   for (c = m->clients; c; c = c->next)
     if (ISVISIBLE(c))
       n++;
   if (n > 0) /* override layout symbol */
     snprintf(m->ltsymbol, sizeof m->ltsymbol, "[%d]", n);
+  for (top = m->stack; top && (top->isfloating || !ISVISIBLE(top)); top = top->snext)
+    ;
+  if (top && monocle_presize && !(next = nexttiled(top->next)))
+    next = nexttiled(m->clients);
   for (c = nexttiled(m->clients); c; c = nexttiled(c->next))
-    resize(c, m->window_area_x, m->window_area_y,
-           m->window_area_width - 2 * c->border_width, m->window_area_height - 2 * c->border_width,
-           0);
+    if (c == top || c == next)
+      resize(c, m->window_area_x, m->window_area_y,
+             m->window_area_width - 2 * c->border_width,
+             m->window_area_height - 2 * c->border_width, 0);
+    else
+      defer_resize(c, m->window_area_x, m->window_area_y,
+                   m->window_area_width - 2 * c->border_width,
+                   m->window_area_height - 2 * c->border_width);
 }
 
 
@@ -348,6 +370,9 @@ void setlayout(const Arg *arg) {
     selected_monitor->sellt ^= 1;
   if (arg && arg->v)
     selected_monitor->lt[selected_monitor->sellt] = (Layout *)arg->v;
+  if (!selected_monitor->lt[selected_monitor->sellt]->arrange)
+    selected_monitor->reshow = 1; /* size hints apply to every client now */
+  save_tag_layout(selected_monitor);
   strncpy(selected_monitor->ltsymbol,
           selected_monitor->lt[selected_monitor->sellt]->symbol,
           sizeof selected_monitor->ltsymbol);
@@ -367,6 +392,7 @@ void setmfact(const Arg *arg) {
   if (f < 0.05 || f > 0.95)
     return;
   selected_monitor->mfact = f;
+  save_tag_layout(selected_monitor);
   arrange(selected_monitor);
 }
 
@@ -398,6 +424,17 @@ void setup_autostart(){
 
 }
 
+/* the draw surface used to cover the whole display */
+static void report_bar_surface(void) {
+  unsigned long pixel = DefaultDepth(display, screen) > 16 ? 4 : 2;
+  unsigned long used = (unsigned long)drw->w * drw->h * pixel;
+  unsigned long full = (unsigned long)display_width * display_height * pixel;
+
+  fprintf(stderr,
+          "pwindow_manager: draw surface %ux%u, %lu KiB instead of %lu KiB\n",
+          drw->w, drw->h, used / 1024, full / 1024);
+}
+
 void setup(void) {
 
   XSetWindowAttributes window_attributes;
@@ -411,7 +448,7 @@ void setup(void) {
   display_width = DisplayWidth(display, screen);
   display_height = DisplayHeight(display, screen);
   root = RootWindow(display, screen);
-  drw = drw_create(display, screen, root, display_width, display_height);
+  drw = drw_create(display, screen, root, 1, 1);
 
 
   //setting fonts
@@ -421,6 +458,8 @@ void setup(void) {
   bar_height = drw->fonts->h + 2;
 
   //this configure all screen for using it
+  setup_randr();
+  setup_sync();
   updategeom();
 
   /* init atoms */
@@ -436,10 +475,18 @@ void setup(void) {
   netatom[NetWMCheck] = XInternAtom(display, "_NET_SUPPORTING_WM_CHECK", False);
   netatom[NetWMFullscreen] =
       XInternAtom(display, "_NET_WM_STATE_FULLSCREEN", False);
+  netatom[NetWMHidden] = XInternAtom(display, "_NET_WM_STATE_HIDDEN", False);
   netatom[NetWMWindowType] = XInternAtom(display, "_NET_WM_WINDOW_TYPE", False);
   netatom[NetWMWindowTypeDialog] =
       XInternAtom(display, "_NET_WM_WINDOW_TYPE_DIALOG", False);
   netatom[NetClientList] = XInternAtom(display, "_NET_CLIENT_LIST", False);
+  netatom[NetWMBypassCompositor] =
+      XInternAtom(display, "_NET_WM_BYPASS_COMPOSITOR", False);
+  netatom[NetWMPid] = XInternAtom(display, "_NET_WM_PID", False);
+  netatom[NetWMSyncRequest] =
+      XInternAtom(display, "_NET_WM_SYNC_REQUEST", False);
+  netatom[NetWMSyncRequestCounter] =
+      XInternAtom(display, "_NET_WM_SYNC_REQUEST_COUNTER", False);
 
   /* init cursors */
   cursor[CurNormal] = drw_cur_create(drw, XC_left_ptr);
@@ -454,6 +501,9 @@ void setup(void) {
 
   /* init bars */
   create_bars();
+  resize_bar_surface();
+  report_bar_surface();
+  update_sensors();
   updatestatus();
 
 
@@ -475,7 +525,7 @@ void setup(void) {
   /* select events */
   window_attributes.cursor = cursor[CurNormal]->cursor;
   window_attributes.event_mask = SubstructureRedirectMask | SubstructureNotifyMask |
-                  ButtonPressMask | PointerMotionMask | EnterWindowMask |
+                  ButtonPressMask | EnterWindowMask |
                   LeaveWindowMask | StructureNotifyMask | PropertyChangeMask;
   XChangeWindowAttributes(display, root, CWEventMask | CWCursor, &window_attributes);
   XSelectInput(display, root, window_attributes.event_mask);
@@ -585,21 +635,62 @@ void toggletag(const Arg *arg) {
   }
 }
 
+/* the tag operations below only change state, callers arrange and focus */
+static int view_monitor(Monitor *m, unsigned int mask) {
+  if ((mask & TAGMASK) == m->tagset[m->seltags])
+    return 0;
+  m->seltags ^= 1; /* toggle sel tagset */
+  if (mask & TAGMASK)
+    m->tagset[m->seltags] = mask & TAGMASK;
+  load_tag_layout(m);
+  return 1;
+}
+
+static int toggleview_monitor(Monitor *m, unsigned int mask) {
+  unsigned int newtagset = m->tagset[m->seltags] ^ (mask & TAGMASK);
+
+  if (!newtagset)
+    return 0;
+  m->tagset[m->seltags] = newtagset;
+  load_tag_layout(m);
+  return 1;
+}
+
+/* arranges a monitor changed by a multi-monitor tag operation, monitors
+ * other than the selected one get their top visible client selected */
+static void finish_monitor_view(Monitor *m) {
+  Client *c;
+
+  if (m != selected_monitor) {
+    for (c = m->stack; c && !ISVISIBLE(c); c = c->snext)
+      ;
+    m->selected_client = c;
+  }
+  arrange(m);
+}
+
+/* one focus and bar redraw for the whole operation */
+static void finish_monitor_views(void) {
+  focus(NULL);
+  if (nview_warp)
+    set_mouse_position_to_monitor(selected_monitor);
+}
+
 void ntoggleview(const Arg *arg) {
-  const Arg n = {.i = +1};
-  const int mon = selected_monitor->num;
-  do {
-    focus_monitor(&n);
-    toggleview(arg);
-  } while (selected_monitor->num != mon);
+  Monitor *m;
+  int changed = 0;
+
+  for (m = monitors; m; m = m->next)
+    if (toggleview_monitor(m, arg->ui)) {
+      finish_monitor_view(m);
+      changed = 1;
+    }
+  if (changed)
+    finish_monitor_views();
 }
 
 void toggleview(const Arg *arg) {
-  unsigned int newtagset =
-      selected_monitor->tagset[selected_monitor->seltags] ^ (arg->ui & TAGMASK);
-
-  if (newtagset) {
-    selected_monitor->tagset[selected_monitor->seltags] = newtagset;
+  if (toggleview_monitor(selected_monitor, arg->ui)) {
     focus(NULL);
     arrange(selected_monitor);
   }
@@ -612,12 +703,17 @@ void unmanage(Client *c, int destroyed) {
 
   detach(c);
   detachstack(c);
+  float_index_remove(c);
+  if (m->occluder == c)
+    m->occluder = NULL;
+  if (m->game == c)
+    update_game_mode(m);
   if (!destroyed) {
     wc.border_width = c->oldbw;
     XGrabServer(display); /* avoid race conditions */
     XSetErrorHandler(xerrordummy);
     XSelectInput(display, c->win, NoEventMask);
-    XConfigureWindow(display, c->win, CWBorderWidth, &wc); /* restore border */
+    shadow_configure(c, CWBorderWidth, &wc); /* restore border */
     XUngrabButton(display, AnyButton, AnyModifier, c->win);
     setclientstate(c, WithdrawnState);
     XSync(display, False);
@@ -633,26 +729,29 @@ void unmanage(Client *c, int destroyed) {
 
 
 void updateclientlist(void) {
+  Monitor *lists[] = {monitors, parked_monitors};
   Client *c;
   Monitor *m;
+  size_t i;
 
   XDeleteProperty(display, root, netatom[NetClientList]);
-  for (m = monitors; m; m = m->next)
-    for (c = m->clients; c; c = c->next)
-      XChangeProperty(display, root, netatom[NetClientList], XA_WINDOW, 32,
-                      PropModeAppend, (unsigned char *)&(c->win), 1);
+  for (i = 0; i < LENGTH(lists); i++)
+    for (m = lists[i]; m; m = m->next)
+      for (c = m->clients; c; c = c->next)
+        XChangeProperty(display, root, netatom[NetClientList], XA_WINDOW, 32,
+                        PropModeAppend, (unsigned char *)&(c->win), 1);
 }
 
 void updatenumlockmask(void) {
   unsigned int i, j;
   XModifierKeymap *modmap;
+  KeyCode numlock = XKeysymToKeycode(display, XK_Num_Lock);
 
   numlockmask = 0;
   modmap = XGetModifierMapping(display);
   for (i = 0; i < 8; i++)
     for (j = 0; j < modmap->max_keypermod; j++)
-      if (modmap->modifiermap[i * modmap->max_keypermod + j] ==
-          XKeysymToKeycode(display, XK_Num_Lock))
+      if (numlock && modmap->modifiermap[i * modmap->max_keypermod + j] == numlock)
         numlockmask = (1 << i);
   XFreeModifiermap(modmap);
 }
@@ -692,61 +791,54 @@ void updatewmhints(Client *c) {
 }
 
 void nview(const Arg *arg) {
-  const Arg n = {.i = +1};
-  const int mon = selected_monitor->num;
-  do {
-    focus_monitor(&n);
-    view(arg);
-  } while (selected_monitor->num != mon);
+  Monitor *m;
+  int changed = 0;
+
+  for (m = monitors; m; m = m->next)
+    if (view_monitor(m, arg->ui)) {
+      finish_monitor_view(m);
+      changed = 1;
+    }
+  if (changed)
+    finish_monitor_views();
 }
 
 void view(const Arg *arg) {
-  if ((arg->ui & TAGMASK) ==
-      selected_monitor->tagset[selected_monitor->seltags])
-    return;
-  selected_monitor->seltags ^= 1; /* toggle sel tagset */
-  if (arg->ui & TAGMASK)
-    selected_monitor->tagset[selected_monitor->seltags] = arg->ui & TAGMASK;
-  focus(NULL);
-  arrange(selected_monitor);
+  if (view_monitor(selected_monitor, arg->ui)) {
+    focus(NULL);
+    arrange(selected_monitor);
+  }
 }
 
 
 
+/* per monitor defaults, for monitors past the end of the tables too */
 void reset_view(const Arg *arg) {
-  const int mon = selected_monitor->num;
-  Arg n = {.i = +1}; // focusmon(next monitor)
-  Arg m = {.f = 0};  // mfact -> facts[]
-  Arg i = {.i = 0};  // nmaster -> masters[]
-  Arg v = {.ui = 0}; // nviews -> views[]
-  Arg t = {.ui = 0}; // toggles[] -> toggleview()
-  unsigned int x;
-  do {
-    focus_monitor(&n);
-    m.f =
-        (facts[selected_monitor->num] ? facts[selected_monitor->num] : mfact) +
-        1;
-    i.i = (masters[selected_monitor->num] ? masters[selected_monitor->num]
-                                          : nmaster) -
-          selected_monitor->nmaster;
-    v.ui = (views[selected_monitor->num] == ~0
-                ? ~0
-                : ((1 << (views[selected_monitor->num]
-                              ? (views[selected_monitor->num] + 1)
-                              : (nviews + 1))) -
-                   1));
-    setmfact(&m);
-    incnmaster(&i);
-    view(&v);
-    for (x = 0; x < LENGTH(toggles[selected_monitor->num]); x++) {
-      if ((toggles[selected_monitor->num][x] ||
-           toggles[selected_monitor->num][x] == 0) &&
-          toggles[selected_monitor->num][x] != ~0) {
-        t.ui = (1 << toggles[selected_monitor->num][x]);
-        toggleview(&t);
-      };
-    }
-  } while (selected_monitor->num != mon);
+  Monitor *m;
+  unsigned int x, num;
+  float f;
+
+  for (m = monitors; m; m = m->next) {
+    num = m->num;
+    if (num < LENGTH(views) && views[num] == ~0)
+      view_monitor(m, ~0);
+    else
+      view_monitor(m, (1 << (num < LENGTH(views) && views[num]
+                                 ? views[num] + 1
+                                 : nviews + 1)) -
+                          1); /* first, mfact and nmaster are kept per tag */
+    f = num < LENGTH(facts) && facts[num] ? facts[num] : mfact;
+    if (m->lt[m->sellt]->arrange && f >= 0.05 && f <= 0.95)
+      m->mfact = f;
+    m->nmaster =
+        MAX(num < LENGTH(masters) && masters[num] ? masters[num] : nmaster, 0);
+    save_tag_layout(m);
+    for (x = 0; num < LENGTH(toggles) && x < LENGTH(toggles[num]); x++)
+      if (toggles[num][x] != ~0)
+        toggleview_monitor(m, 1 << toggles[num][x]);
+    finish_monitor_view(m);
+  }
+  finish_monitor_views();
 }
 
 void movestack(const Arg *arg) {
@@ -828,12 +920,32 @@ int main() {
 
   /* main event loop */
   XEvent window_manager_events;
+  int jumped;
+  struct pollfd connection = {.fd = ConnectionNumber(display), .events = POLLIN};
   XSync(display, False);
-  while (running && !XNextEvent(display, &window_manager_events)) {
-    if (handler[window_manager_events.type]) {
-      handler[window_manager_events.type](
-          &window_manager_events); /* call handler */
+  while (running) {
+    /* sleep until the next event or timer */
+    if (!XPending(display)) {
+      if (poll(&connection, 1, timer_timeout()) < 0 && errno != EINTR)
+        die("poll:");
+      timer_run_expired();
+      continue;
+    }
+    jumped = next_event(&window_manager_events);
+    /* extension event types lie past the end of handler[] */
+    if (window_manager_events.type < LASTEvent) {
+      if (handler[window_manager_events.type])
+        handler[window_manager_events.type](
+            &window_manager_events); /* call handler */
+    } else if (randr_event_base >= 0 &&
+               (window_manager_events.type ==
+                    randr_event_base + RRScreenChangeNotify ||
+                window_manager_events.type == randr_event_base + RRNotify)) {
+      randrnotify(&window_manager_events);
     }
+    report_key(&window_manager_events, jumped);
+    timer_run_expired();
+    shadow_report();
     // move_godot_to_monitor(0);
   }
 
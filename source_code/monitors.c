@@ -3,156 +3,230 @@
 #include "pwindow_manager.h"
 #include "util.h"
 #include "windows.h"
+#include "shadow.h"
+#include "timer.h"
+#include "floating.h"
 #include <X11/X.h>
 #include <X11/Xlib.h>
-#include <X11/extensions/Xinerama.h>
+#include <X11/extensions/Xrandr.h>
+#include <X11/extensions/shape.h>
 #include <stddef.h>
+#include <stdlib.h>
 #include <stdio.h>
 #include <string.h>
 #include "config.h"
 
-#include <pthread.h>
-#include <unistd.h>
-#include <stdbool.h>
 
-
-typedef struct HigthlightMonitor{
-  Window window[4];
-  int size;
-}HigthlightMonitor;
-
-HigthlightMonitor hightlight;
-bool is_highligthing = false;
-
-void fill_higtlight_window(Window window, int width, int height) {
-
-  draw_rectangle(drw, 0, 0, width, height, 1, 0);
-
-  drw_map(drw, window, 0, 0, width, height);
+/* geometry a layout last gave to the tiled clients of a tag */
+typedef struct {
+  Client *client;
+  Window win;
+  int x, y, w, h, border_width;
+  int deferred;                 /* x, y, w, h are the arguments of a deferred resize */
+} CachedGeometry;
+
+typedef struct {
+  const Layout *layout;
+  float mfact;
+  int nmaster;
+  int window_area_x, window_area_y, window_area_width, window_area_height;
+  int nvisible;
+  char ltsymbol[16];
+  CachedGeometry *geometry;
+  int length, size;
+} TagCache;
+
+/* layout state per tag, index 0 is used while several tags are viewed */
+struct Pertag {
+  unsigned int curtag;
+  int nmasters[LENGTH(tags) + 1];
+  float mfacts[LENGTH(tags) + 1];
+  unsigned int sellts[LENGTH(tags) + 1];
+  const Layout *ltidxs[LENGTH(tags) + 1][2];
+  TagCache caches[LENGTH(tags) + 1];
+};
+
+static Monitor *highlighted;
+
+static Monitor **monitor_index; /* monitors by num */
+static int nmonitors;
+
+/* cells between the distinct monitor edges, each knows its monitor */
+static struct {
+  int *xs, *ys;
+  int nx, ny;
+  Monitor **cells;
+} grid;
+
+/* one override-redirect frame per monitor, shaped into a ring that takes
+ * no input; created on first use and dropped when the monitor moves */
+static void create_highlight_window(Monitor *m) {
+  XSetWindowAttributes wa = {
+      .override_redirect = True,
+      .background_pixel = color_scheme[SchemeSelected][ColFg].pixel};
+  XClassHint class_hint = {"pwindow_manager", "pwindow_manager"};
+  XRectangle ring[] = {
+      {0, 0, m->screen_width, highlightpx},
+      {0, m->screen_height - highlightpx, m->screen_width, highlightpx},
+      {0, 0, highlightpx, m->screen_height},
+      {m->screen_width - highlightpx, 0, highlightpx, m->screen_height},
+  };
+
+  m->highlight_window = XCreateWindow(
+      display, root, m->screen_x, m->screen_y, m->screen_width,
+      m->screen_height, 0, DefaultDepth(display, screen), CopyFromParent,
+      DefaultVisual(display, screen), CWOverrideRedirect | CWBackPixel, &wa);
+  XSetClassHint(display, m->highlight_window, &class_hint);
+  XShapeCombineRectangles(display, m->highlight_window, ShapeBounding, 0, 0,
+                          ring, LENGTH(ring), ShapeSet, Unsorted);
+  XShapeCombineRectangles(display, m->highlight_window, ShapeInput, 0, 0, NULL,
+                          0, ShapeSet, Unsorted);
 }
 
-void *show_higthligth_window(void *in_monitor) {
-  if (is_highligthing) {
-    for (int i = 0; i < 4; i++) { // we have four corners
-
-      XDestroyWindow(display, hightlight.window[i]);
-    }
-    is_highligthing = false;
-  }
+static void destroy_highlight_window(Monitor *m) {
+  if (!m->highlight_window)
+    return;
+  if (m == highlighted)
+    highlighted = NULL;
+  XDestroyWindow(display, m->highlight_window);
+  m->highlight_window = None;
+}
 
-  Monitor *monitor = (Monitor *)in_monitor;
+static void destroy_sensor(Monitor *m) {
+  if (!m->sensor)
+    return;
+  XDestroyWindow(display, m->sensor);
+  m->sensor = None;
+}
 
+/* every monitor is covered by an InputOnly window at the bottom of the
+ * stack, entering it or the bar is the only event a monitor change over
+ * the desktop, gaps or bar produces; clicks on it propagate to root */
+void update_sensors(void) {
   XSetWindowAttributes wa = {.override_redirect = True,
-                             .background_pixmap = ParentRelative,
-                             .event_mask = ExposureMask};
-
-  XClassHint class_hint = {"pwindow_manager", "pwindow_manager"};
-
-  int x, y, width, height;
-  hightlight.size = 25;//pixels
-
-  for (int i = 0; i < 4; i++) { // we have four corners
-
-    switch (i) {
-    case 0://up
-      x = monitor->screen_x;
-      y = monitor->screen_y;
-      width = monitor->screen_width;
-      height = hightlight.size;
-      break;
-    case 1://right
-      x = monitor->screen_x+(monitor->screen_width-hightlight.size);
-      y = monitor->screen_y;
-      width = hightlight.size;
-      height = monitor->screen_height;
-      break;
-    case 2://botton
-      x = monitor->screen_x;
-      y = monitor->screen_y+(monitor->screen_height-hightlight.size);
-      width = monitor->screen_width;
-      height = hightlight.size;
-      break;
-    case 3://left
-      x = monitor->screen_x;
-      y = monitor->screen_y;
-      width = hightlight.size;
-      height = monitor->screen_height;
-      break;
-    }
-
-    hightlight.window[i] = XCreateWindow(
-        display, root, x, y, width, height, 0, DefaultDepth(display, screen),
-        CopyFromParent, DefaultVisual(display, screen),
-        CWOverrideRedirect | CWBackPixmap | CWEventMask, &wa);
-
-    XMapRaised(display, hightlight.window[i]);
-    XSetClassHint(display, hightlight.window[i], &class_hint);
-    
-
-    switch (i) {
-    case 0://up
-      fill_higtlight_window(hightlight.window[i], monitor->screen_width, hightlight.size);
-      break;
-    case 1://right
-      fill_higtlight_window(hightlight.window[i], hightlight.size, monitor->screen_height);
-      break;
-    case 2://botton
-      fill_higtlight_window(hightlight.window[i], monitor->screen_width, hightlight.size);
-      break;
-    case 3://left
-      fill_higtlight_window(hightlight.window[i], hightlight.size, monitor->screen_height);
-      break;
-    }
-
+                             .event_mask = EnterWindowMask};
+  Monitor *m;
 
+  for (m = monitors; m; m = m->next) {
+    if (!m->sensor) {
+      m->sensor = XCreateWindow(display, root, m->screen_x, m->screen_y,
+                                m->screen_width, m->screen_height, 0, 0,
+                                InputOnly, CopyFromParent,
+                                CWOverrideRedirect | CWEventMask, &wa);
+      XLowerWindow(display, m->sensor);
+      XMapWindow(display, m->sensor);
+    } else if (m->dirty)
+      XMoveResizeWindow(display, m->sensor, m->screen_x, m->screen_y,
+                        m->screen_width, m->screen_height);
   }
-  is_highligthing = true;
-
-  sleep(1);
+}
 
-  if (is_highligthing == true) {
+void hide_highlight(void) {
+  if (!highlighted)
+    return;
+  XUnmapWindow(display, highlighted->highlight_window);
+  highlighted = NULL;
+}
 
-    for (int i = 0; i < 4; i++) { // we have four corners
+void hightlight_focused_monitor(Monitor *monitor) {
+  if (monitor->game)
+    return;
+  if (highlighted != monitor)
+    hide_highlight();
+  if (!monitor->highlight_window)
+    create_highlight_window(monitor);
+  XMapRaised(display, monitor->highlight_window);
+  highlighted = monitor;
+  timer_start(TimerHighlight, highlight_ms);
+}
 
-      XDestroyWindow(display, hightlight.window[i]);
+/* marks in keep[] the longest run of clients whose last sent stacking
+ * positions already follow the wanted order, only the others need to move */
+static void keep_stacking_order(Monitor *m, Client **order, int n, char *keep) {
+  static int *tail, *parent, size;
+  int i, lo, hi, mid, len = 0;
+
+  if (n > size) {
+    free(tail);
+    free(parent);
+    tail = ecalloc(n, sizeof(int));
+    parent = ecalloc(n, sizeof(int));
+    size = n;
+  }
+  for (i = 0; i < n; i++) {
+    keep[i] = 0;
+    parent[i] = -1;
+    if (!m->stackepoch || order[i]->stackepoch != m->stackepoch)
+      continue;
+    for (lo = 0, hi = len; lo < hi;) {
+      mid = (lo + hi) / 2;
+      if (order[tail[mid]]->stackpos < order[i]->stackpos)
+        lo = mid + 1;
+      else
+        hi = mid;
     }
+    parent[i] = lo ? tail[lo - 1] : -1;
+    tail[lo] = i;
+    if (lo == len)
+      len++;
   }
-
-  draw_bars();
-
-  return NULL;
-}
-
-void hightlight_focused_monitor(Monitor* monitor){
-
-  pthread_t thread_id;
-
-
-  pthread_create(&thread_id,NULL,show_higthligth_window, monitor);
-
-
+  for (i = len ? tail[len - 1] : -1; i >= 0; i = parent[i])
+    keep[i] = 1;
 }
 
 void restack(Monitor *m) {
+  static Client **order;
+  static char *keep;
+  static int size;
+  static unsigned int epochs;
   Client *c;
   XEvent ev;
   XWindowChanges wc;
+  int i, n, sent = 0;
 
   draw_bar(m);
   if (!m->selected_client)
     return;
-  if (m->selected_client->isfloating || !m->lt[m->sellt]->arrange)
-    XRaiseWindow(display, m->selected_client->win);
-  if (m->lt[m->sellt]->arrange) {
-    wc.stack_mode = Below;
-    wc.sibling = m->bar_window;
-    for (c = m->stack; c; c = c->snext)
-      if (!c->isfloating && ISVISIBLE(c)) {
-        XConfigureWindow(display, c->win, CWSibling | CWStackMode, &wc);
-        wc.sibling = c->win;
+  if (m->selected_client->isfloating || !m->lt[m->sellt]->arrange) {
+    shadow_raise(m->selected_client);
+    sent = 1;
+  }
+  if (m->lt[m->sellt]->arrange && !m->occluder) {
+    for (n = 0, c = m->stack; c; c = c->snext)
+      if (!c->isfloating && ISVISIBLE(c))
+        n++;
+    if (n > size) {
+      free(order);
+      free(keep);
+      order = ecalloc(n, sizeof(Client *));
+      keep = ecalloc(n, sizeof(char));
+      size = n;
+    }
+    for (i = 0, c = m->stack; c; c = c->snext)
+      if (!c->isfloating && ISVISIBLE(c))
+        order[i++] = c;
+    keep_stacking_order(m, order, n, keep);
+    for (i = 0; i < n && keep[i]; i++)
+      ;
+    if (i < n) {
+      /* positions of clients outside order are unknown after any move */
+      m->stackepoch = ++epochs;
+      wc.stack_mode = Below;
+      for (i = 0; i < n; i++) {
+        /* the siblings of kept clients go stale as their neighbours move,
+         * none of them may suppress a later move */
+        shadow_forget_stacking(order[i]);
+        if (!keep[i]) {
+          wc.sibling = i ? order[i - 1]->win : m->bar_window;
+          sent |= shadow_configure(order[i], CWSibling | CWStackMode, &wc);
+        }
+        order[i]->stackpos = i;
+        order[i]->stackepoch = m->stackepoch;
       }
+    }
   }
-  XSync(display, False);
+  if (sent)
+    XSync(display, False);
   while (XCheckMaskEvent(display, EnterWindowMask, &ev))
     ;
 }
@@ -167,13 +241,13 @@ void set_mouse_position_to_monitor(Monitor* monitor){
   XWarpPointer(display, None, root, 0, 0, 0, 0, x, y);
 }
 
-void focus_monitor_number(int number){
-  Monitor* monitor = &monitors[number];
+void focus_monitor_number(int number) {
+  Monitor *monitor = numtomon(number);
 
   unfocus(selected_monitor->selected_client, 0);
-
+  selected_monitor = monitor;
   set_mouse_position_to_monitor(monitor);
-
+  focus(NULL);
 }
 
 void focus_monitor(const Arg *arg) {
@@ -191,51 +265,337 @@ void focus_monitor(const Arg *arg) {
   focus(NULL);
 }
 
+void focus_monitor_direction(const Arg *arg) {
+  Monitor *monitor = selected_monitor->neighbour[arg->i];
+
+  if (!monitor)
+    return;
+  unfocus(selected_monitor->selected_client, 0);
+  selected_monitor = monitor;
+  set_mouse_position_to_monitor(monitor);
+  focus(NULL);
+}
+
+void tagmon_direction(const Arg *arg) {
+  Monitor *monitor = selected_monitor->neighbour[arg->i];
+
+  if (!selected_monitor->selected_client || !monitor)
+    return;
+  sendmon(selected_monitor->selected_client, monitor);
+}
 
 Monitor *dirtomon(int dir) {
-  Monitor *m = NULL;
+  int num = selected_monitor->num + (dir > 0 ? 1 : -1);
 
-  if (dir > 0) {
-    if (!(m = selected_monitor->next))
-      m = monitors;
-  } else if (selected_monitor == monitors)
-    for (m = monitors; m->next; m = m->next)
-      ;
+  return monitor_index[(num + nmonitors) % nmonitors];
+}
+
+Monitor *numtomon(int num) {
+  return monitor_index[MAX(0, MIN(num, nmonitors - 1))];
+}
+
+/* distance from a to b in direction dir, -1 when b is not that way or does
+ * not share an edge span with a */
+static int neighbour_distance(Monitor *a, Monitor *b, int dir) {
+  int overlap;
+
+  if (dir == DirLeft || dir == DirRight)
+    overlap = MIN(a->screen_y + a->screen_height,
+                  b->screen_y + b->screen_height) -
+              MAX(a->screen_y, b->screen_y);
   else
-    for (m = monitors; m->next != selected_monitor; m = m->next)
-      ;
+    overlap = MIN(a->screen_x + a->screen_width, b->screen_x + b->screen_width) -
+              MAX(a->screen_x, b->screen_x);
+  if (overlap <= 0)
+    return -1;
+  switch (dir) {
+  case DirLeft:
+    return b->screen_x + b->screen_width <= a->screen_x
+               ? a->screen_x - (b->screen_x + b->screen_width)
+               : -1;
+  case DirRight:
+    return b->screen_x >= a->screen_x + a->screen_width
+               ? b->screen_x - (a->screen_x + a->screen_width)
+               : -1;
+  case DirUp:
+    return b->screen_y + b->screen_height <= a->screen_y
+               ? a->screen_y - (b->screen_y + b->screen_height)
+               : -1;
+  default:
+    return b->screen_y >= a->screen_y + a->screen_height
+               ? b->screen_y - (a->screen_y + a->screen_height)
+               : -1;
+  }
+}
+
+static int compare_int(const void *a, const void *b) {
+  return *(const int *)a - *(const int *)b;
+}
+
+/* sorted distinct values, returns their count */
+static int unique_edges(int *edges, int n) {
+  int i, len = 0;
+
+  qsort(edges, n, sizeof(int), compare_int);
+  for (i = 0; i < n; i++)
+    if (!len || edges[len - 1] != edges[i])
+      edges[len++] = edges[i];
+  return len;
+}
+
+/* index of the grid column or row holding v, -1 outside the grid */
+static int edge_span(const int *edges, int n, int v) {
+  int lo = 0, hi = n - 1, mid;
+
+  if (n < 2 || v < edges[0] || v >= edges[n - 1])
+    return -1;
+  while (hi - lo > 1) {
+    mid = (lo + hi) / 2;
+    if (edges[mid] <= v)
+      lo = mid;
+    else
+      hi = mid;
+  }
+  return lo;
+}
+
+/* rebuilds the monitor index, the neighbours of every monitor and the grid
+ * of distinct monitor edges used by pointtomon; monitors only change on
+ * hotplug */
+static void update_topology(void) {
+  Monitor *m, *o;
+  int i, j, dir, d, best;
+
+  for (nmonitors = 0, m = monitors; m; m = m->next)
+    nmonitors++;
+  free(monitor_index);
+  free(grid.xs);
+  free(grid.ys);
+  free(grid.cells);
+  monitor_index = ecalloc(nmonitors, sizeof(Monitor *));
+  grid.xs = ecalloc(2 * nmonitors, sizeof(int));
+  grid.ys = ecalloc(2 * nmonitors, sizeof(int));
+  for (i = 0, m = monitors; m; m = m->next, i++) {
+    monitor_index[i] = m;
+    grid.xs[2 * i] = m->screen_x;
+    grid.xs[2 * i + 1] = m->screen_x + m->screen_width;
+    grid.ys[2 * i] = m->screen_y;
+    grid.ys[2 * i + 1] = m->screen_y + m->screen_height;
+  }
+
+  for (m = monitors; m; m = m->next)
+    for (dir = 0; dir < DirLast; dir++) {
+      m->neighbour[dir] = NULL;
+      for (best = -1, o = monitors; o; o = o->next)
+        if (o != m && (d = neighbour_distance(m, o, dir)) >= 0 &&
+            (best < 0 || d < best)) {
+          best = d;
+          m->neighbour[dir] = o;
+        }
+    }
+
+  grid.nx = unique_edges(grid.xs, 2 * nmonitors);
+  grid.ny = unique_edges(grid.ys, 2 * nmonitors);
+  grid.cells = ecalloc(MAX(1, (grid.nx - 1) * (grid.ny - 1)), sizeof(Monitor *));
+  for (j = 0; j + 1 < grid.ny; j++)
+    for (i = 0; i + 1 < grid.nx; i++)
+      for (m = monitors; m; m = m->next)
+        if (m->screen_x <= grid.xs[i] &&
+            grid.xs[i] < m->screen_x + m->screen_width &&
+            m->screen_y <= grid.ys[j] &&
+            grid.ys[j] < m->screen_y + m->screen_height) {
+          grid.cells[j * (grid.nx - 1) + i] = m;
+          break;
+        }
+}
+
+/* monitor under a point, the selected one when no monitor covers it */
+Monitor *pointtomon(int x, int y) {
+  Monitor *m = selected_monitor;
+  int i, j;
+
+  if (x >= m->screen_x && x < m->screen_x + m->screen_width &&
+      y >= m->screen_y && y < m->screen_y + m->screen_height)
+    return m;
+  if ((i = edge_span(grid.xs, grid.nx, x)) < 0 ||
+      (j = edge_span(grid.ys, grid.ny, y)) < 0 ||
+      !(m = grid.cells[j * (grid.nx - 1) + i]))
+    return selected_monitor;
   return m;
 }
 
-Monitor *numtomon(int num) {
-  Monitor *m = NULL;
-  int i = 0;
 
-  for (m = monitors, i = 0; m->next && i < num; m = m->next) {
+static unsigned int tag_index(unsigned int tagset) {
+  unsigned int i;
+
+  if (!tagset || (tagset & (tagset - 1)))
+    return 0;
+  for (i = 1; !(tagset & 1); tagset >>= 1)
     i++;
+  return i;
+}
+
+void load_tag_layout(Monitor *m) {
+  Pertag *p = m->pertag;
+
+  p->curtag = tag_index(m->tagset[m->seltags]);
+  m->nmaster = p->nmasters[p->curtag];
+  m->mfact = p->mfacts[p->curtag];
+  m->sellt = p->sellts[p->curtag];
+  m->lt[0] = p->ltidxs[p->curtag][0];
+  m->lt[1] = p->ltidxs[p->curtag][1];
+  if (!m->lt[m->sellt]->arrange)
+    m->reshow = 1;
+}
+
+void save_tag_layout(Monitor *m) {
+  Pertag *p = m->pertag;
+
+  p->nmasters[p->curtag] = m->nmaster;
+  p->mfacts[p->curtag] = m->mfact;
+  p->sellts[p->curtag] = m->sellt;
+  p->ltidxs[p->curtag][0] = m->lt[0];
+  p->ltidxs[p->curtag][1] = m->lt[1];
+}
+
+static int count_visible(Monitor *m) {
+  Client *c;
+  int n = 0;
+
+  for (c = m->clients; c; c = c->next)
+    if (ISVISIBLE(c))
+      n++;
+  return n;
+}
+
+/* reapplies the geometry the layout last produced for the current tag when
+ * neither its tiled clients nor its parameters changed since */
+static int apply_cached_geometry(Monitor *m) {
+  TagCache *tc = &m->pertag->caches[m->pertag->curtag];
+  CachedGeometry *g;
+  Client *c;
+  int i;
+
+  if (tc->layout != m->lt[m->sellt] || tc->mfact != m->mfact ||
+      tc->nmaster != m->nmaster || tc->window_area_x != m->window_area_x ||
+      tc->window_area_y != m->window_area_y ||
+      tc->window_area_width != m->window_area_width ||
+      tc->window_area_height != m->window_area_height ||
+      tc->nvisible != count_visible(m))
+    return 0;
+  for (i = 0, c = nexttiled(m->clients); c; c = nexttiled(c->next), i++) {
+    if (i >= tc->length)
+      return 0;
+    g = &tc->geometry[i];
+    if (g->client != c || g->win != c->win ||
+        g->border_width != c->border_width || (resizehints && !c->hintsvalid))
+      return 0;
   }
-  return m;
+  if (i != tc->length)
+    return 0;
+
+  for (i = 0; i < tc->length; i++) {
+    g = &tc->geometry[i];
+    c = g->client;
+    if (g->deferred)
+      defer_resize(c, g->x, g->y, g->w, g->h);
+    else if (c->x != g->x || c->y != g->y || c->w != g->w || c->h != g->h)
+      resizeclient(c, g->x, g->y, g->w, g->h);
+    else
+      c->isdeferred = 0; /* a target deferred since is superseded */
+  }
+  strncpy(m->ltsymbol, tc->ltsymbol, sizeof m->ltsymbol);
+  return 1;
+}
+
+static void cache_geometry(Monitor *m) {
+  TagCache *tc = &m->pertag->caches[m->pertag->curtag];
+  CachedGeometry *g;
+  Client *c;
+  int n;
+
+  for (n = 0, c = nexttiled(m->clients); c; c = nexttiled(c->next))
+    n++;
+  if (n > tc->size) {
+    free(tc->geometry);
+    tc->geometry = ecalloc(n, sizeof(CachedGeometry));
+    tc->size = n;
+  }
+  for (n = 0, c = nexttiled(m->clients); c; c = nexttiled(c->next), n++) {
+    g = &tc->geometry[n];
+    g->client = c;
+    g->win = c->win;
+    g->deferred = c->isdeferred;
+    g->x = c->isdeferred ? c->deferx : c->x;
+    g->y = c->isdeferred ? c->defery : c->y;
+    g->w = c->isdeferred ? c->deferw : c->w;
+    g->h = c->isdeferred ? c->deferh : c->h;
+    g->border_width = c->border_width;
+  }
+  tc->length = n;
+  tc->layout = m->lt[m->sellt];
+  tc->mfact = m->mfact;
+  tc->nmaster = m->nmaster;
+  tc->window_area_x = m->window_area_x;
+  tc->window_area_y = m->window_area_y;
+  tc->window_area_width = m->window_area_width;
+  tc->window_area_height = m->window_area_height;
+  tc->nvisible = count_visible(m);
+  strncpy(tc->ltsymbol, m->ltsymbol, sizeof tc->ltsymbol);
 }
 
+/* while a visible fullscreen client covers the whole monitor, layout
+ * resizes and restacks of the clients below it are deferred */
+static void update_occluder(Monitor *m) {
+  Client *c;
+
+  m->occluder = NULL;
+  for (c = m->clients; c; c = c->next)
+    if (c->isfullscreen && ISVISIBLE(c) && c->x <= m->screen_x &&
+        c->y <= m->screen_y &&
+        c->x + WIDTH(c) >= m->screen_x + m->screen_width &&
+        c->y + HEIGHT(c) >= m->screen_y + m->screen_height) {
+      m->occluder = c;
+      return;
+    }
+}
 
 void arrangemon(Monitor *m) {
   strncpy(m->ltsymbol, m->lt[m->sellt]->symbol, sizeof m->ltsymbol);
-  if (m->lt[m->sellt]->arrange)
+  if (!m->lt[m->sellt]->arrange)
+    return;
+  if (m->occluder) { /* the cache would hold deferred geometry */
     m->lt[m->sellt]->arrange(m);
+    return;
+  }
+  if (apply_cached_geometry(m))
+    return;
+  m->lt[m->sellt]->arrange(m);
+  cache_geometry(m);
 }
 
 void arrange(Monitor *m) {
-  if (m)
-    showhide(m->stack);
-  else
-    for (m = monitors; m; m = m->next)
-      showhide(m->stack);
+  if (m && m->parked)
+    return;
+  if (m) {
+    update_occluder(m);
+    update_game_mode(m);
+    showhide(m);
+  } else
+    for (m = monitors; m; m = m->next) {
+      update_occluder(m);
+      update_game_mode(m);
+      showhide(m);
+    }
   if (m) {
     arrangemon(m);
     restack(m);
+    map_shown_clients(m);
   } else
-    for (m = monitors; m; m = m->next)
+    for (m = monitors; m; m = m->next) {
       arrangemon(m);
+      map_shown_clients(m);
+    }
 }
 
 void sendmon(Client *c, Monitor *m) {
@@ -245,8 +605,11 @@ void sendmon(Client *c, Monitor *m) {
   detach(c);
   detachstack(c);
   c->mon = m;
+  c->home = NULL;
   c->tags = m->tagset[m->seltags]; /* assign tags of target monitor */
+  m->reshow = 1;
   attach(c);
+  float_index_update(c);
   attachstack(c);
   focus(NULL);
   arrange(NULL);
@@ -259,95 +622,307 @@ void send_to_monitor(Client *window, Monitor *monitor) {
   detach(window);
   detachstack(window);
   window->mon = monitor;
+  window->home = NULL;
   window->tags =
       monitor->tagset[monitor->seltags]; /* assign tags of target monitor */
+  monitor->reshow = 1;
   attach(window);
+  float_index_update(window);
   attachstack(window);
   focus(NULL);
   arrange(NULL);
 }
 
-int isuniquegeom(XineramaScreenInfo *unique, size_t n,
-                 XineramaScreenInfo *info) {
-  while (n--)
-    if (unique[n].x_org == info->x_org && unique[n].y_org == info->y_org &&
-        unique[n].width == info->width && unique[n].height == info->height)
+/* geometry of an active RandR output, outputs are identified by name */
+typedef struct {
+  char name[32];
+  int x, y, width, height;
+  double refresh_rate;
+  unsigned long mm_width, mm_height;
+} OutputGeometry;
+
+int randr_event_base = -1;
+
+void setup_randr(void) {
+  int error_base;
+
+  if (!XRRQueryExtension(display, &randr_event_base, &error_base)) {
+    randr_event_base = -1;
+    return;
+  }
+  XRRSelectInput(display, root,
+                 RRScreenChangeNotifyMask | RRCrtcChangeNotifyMask |
+                     RROutputChangeNotifyMask);
+}
+
+static double mode_refresh_rate(XRRScreenResources *res, RRMode mode) {
+  double lines;
+  int i;
+
+  for (i = 0; i < res->nmode; i++) {
+    if (res->modes[i].id != mode)
+      continue;
+    lines = res->modes[i].vTotal;
+    if (res->modes[i].modeFlags & RR_DoubleScan)
+      lines *= 2;
+    if (res->modes[i].modeFlags & RR_Interlace)
+      lines /= 2;
+    if (!res->modes[i].hTotal || !lines)
       return 0;
-  return 1;
+    return res->modes[i].dotClock / (res->modes[i].hTotal * lines);
+  }
+  return 0;
 }
 
-int updategeom(void) {
-  int dirty = 0;
+static int add_output(XRRScreenResources *res, RROutput output,
+                      OutputGeometry *outputs, int n) {
+  XRROutputInfo *info;
+  XRRCrtcInfo *crtc;
+  OutputGeometry *o = &outputs[n];
+  int i, added = 0;
+
+  if (!(info = XRRGetOutputInfo(display, res, output)))
+    return 0;
+  if (info->connection == RR_Connected && info->crtc &&
+      (crtc = XRRGetCrtcInfo(display, res, info->crtc))) {
+    if (crtc->mode && crtc->width && crtc->height) {
+      snprintf(o->name, sizeof o->name, "%.*s", info->nameLen, info->name);
+      o->x = crtc->x;
+      o->y = crtc->y;
+      o->width = crtc->width;
+      o->height = crtc->height;
+      o->refresh_rate = mode_refresh_rate(res, crtc->mode);
+      o->mm_width = info->mm_width;
+      o->mm_height = info->mm_height;
+      /* clones and mirrors are one screen */
+      for (added = 1, i = 0; i < n && added; i++)
+        added = outputs[i].x != o->x || outputs[i].y != o->y ||
+                outputs[i].width != o->width || outputs[i].height != o->height;
+    }
+    XRRFreeCrtcInfo(crtc);
+  }
+  XRRFreeOutputInfo(info);
+  return added;
+}
 
-  if (XineramaIsActive(display)) {
-    int i, j, n, nn;
-    Client *c;
-    Monitor *m;
-    XineramaScreenInfo *info = XineramaQueryScreens(display, &nn);
-    XineramaScreenInfo *unique = NULL;
+/* active outputs, the primary one first */
+static int query_outputs(OutputGeometry **outputs) {
+  XRRScreenResources *res;
+  RROutput primary;
+  int i, n = 0;
+
+  *outputs = NULL;
+  if (randr_event_base < 0 ||
+      !(res = XRRGetScreenResourcesCurrent(display, root)))
+    return 0;
+  *outputs = ecalloc(res->noutput + 1, sizeof(OutputGeometry));
+  primary = XRRGetOutputPrimary(display, root);
+  for (i = 0; i < res->noutput; i++)
+    if (res->outputs[i] == primary)
+      n += add_output(res, primary, *outputs, n);
+  for (i = 0; i < res->noutput; i++)
+    if (res->outputs[i] != primary)
+      n += add_output(res, res->outputs[i], *outputs, n);
+  XRRFreeScreenResources(res);
+  return n;
+}
 
-    for (n = 0, m = monitors; m; m = m->next, n++)
-      ;
-    /* only consider unique geometries as separate screens */
-    unique = ecalloc(nn, sizeof(XineramaScreenInfo));
-    for (i = 0, j = 0; i < nn; i++)
-      if (isuniquegeom(unique, j, &info[i]))
-        memcpy(&unique[j++], &info[i], sizeof(XineramaScreenInfo));
-    XFree(info);
-    nn = j;
-
-    /* new monitors if nn > n */
-    for (i = n; i < nn; i++) {
-      for (m = monitors; m && m->next; m = m->next)
-        ;
-      if (m)
-        m->next = createmon();
-      else
-        monitors = createmon();
+static void set_monitor_geometry(Monitor *m, int x, int y, int width,
+                                 int height) {
+  if (m->screen_x == x && m->screen_y == y && m->screen_width == width &&
+      m->screen_height == height)
+    return;
+  destroy_highlight_window(m);
+  m->screen_x = m->window_area_x = x;
+  m->screen_y = m->window_area_y = y;
+  m->screen_width = m->window_area_width = width;
+  m->screen_height = m->window_area_height = height;
+  m->reshow = 1;
+  m->dirty = 1;
+  updatebarpos(m);
+}
+
+static int output_index(OutputGeometry *outputs, int n, const char *name) {
+  int i;
+
+  for (i = 0; i < n; i++)
+    if (!strcmp(outputs[i].name, name))
+      return i;
+  return -1;
+}
+
+/* the hotplug timer fires at the earliest end of a grace period among the
+ * parked monitors still holding clients */
+static void arm_hotplug_timer(void) {
+  Monitor *m;
+  long long next = -1;
+
+  for (m = parked_monitors; m; m = m->next)
+    if (m->clients && (next < 0 || m->parked_at < next))
+      next = m->parked_at;
+  if (next < 0)
+    timer_stop(TimerHotplug);
+  else
+    timer_start(TimerHotplug, MAX(0, next + hotplug_grace - timer_now()));
+}
+
+/* keeps a monitor whose output went away, with its clients, tags and
+ * layouts, so a short blink of the output does not rearrange anything */
+static void park_monitor(Monitor *m) {
+  Monitor **tm;
+
+  for (tm = &monitors; *tm != m; tm = &(*tm)->next)
+    ;
+  *tm = m->next;
+  m->next = parked_monitors;
+  parked_monitors = m;
+  m->parked = 1;
+  hide_clients(m);
+  destroy_highlight_window(m);
+  destroy_sensor(m);
+  m->occluder = NULL;
+  update_game_mode(m);
+  XUnmapWindow(display, m->bar_window);
+  if (m == selected_monitor)
+    selected_monitor = monitors;
+  m->parked_at = timer_now();
+  arm_hotplug_timer();
+}
+
+/* links a parked monitor back in and returns the clients it lent out */
+static Monitor *unpark_monitor(const char *name) {
+  Monitor **tm, *m, *o;
+  Client *c, *next, **tail;
+
+  for (tm = &parked_monitors; *tm; tm = &(*tm)->next)
+    if (!strcmp((*tm)->output_name, name))
+      break;
+  if (!(m = *tm))
+    return NULL;
+  *tm = m->next;
+  m->next = NULL;
+  m->parked = 0;
+  m->reshow = 1;
+  m->dirty = 1;
+  XMapRaised(display, m->bar_window);
+
+  for (tail = &m->clients; *tail; tail = &(*tail)->next)
+    ;
+  for (o = monitors; o; o = o->next)
+    for (c = o->clients; c; c = next) {
+      next = c->next;
+      if (c->home != m)
+        continue;
+      detach(c);
+      detachstack(c);
+      c->mon = m;
+      c->tags = c->hometags;
+      c->x = c->homex;
+      c->y = c->homey;
+      c->home = NULL;
+      c->next = NULL;
+      *tail = c; /* keep the order the clients had */
+      tail = &c->next;
+      float_index_update(c);
+      attachstack(c);
+      o->dirty = 1;
     }
-    for (i = 0, m = monitors; i < nn && m; m = m->next, i++)
-      if (i >= n || unique[i].x_org != m->screen_x || unique[i].y_org != m->screen_y ||
-          unique[i].width != m->screen_width || unique[i].height != m->screen_height) {
-        dirty = 1;
-        m->num = i;
-        /* this is ugly, but it is a race condition otherwise */
-        snprintf(m->monmark, sizeof(m->monmark), "(%d)", m->num);
-        m->screen_x = m->window_area_x = unique[i].x_org;
-        m->screen_y = m->window_area_y = unique[i].y_org;
-        m->screen_width = m->window_area_width = unique[i].width;
-        m->screen_height = m->window_area_height = unique[i].height;
-        updatebarpos(m);
+  return m;
+}
+
+/* clients of parked monitors whose grace period is over, or of all of
+ * them, move to the first monitor and remember where they came from */
+static void adopt_clients(int all) {
+  Monitor *m, *target = monitors;
+  Client *c;
+  long long now = timer_now();
+  int adopted = 0;
+
+  for (m = parked_monitors; m; m = m->next) {
+    if (!all && now < m->parked_at + hotplug_grace)
+      continue;
+    while ((c = m->clients)) {
+      m->clients = c->next;
+      detachstack(c);
+      c->home = m;
+      c->hometags = c->tags;
+      c->homex = c->x;
+      c->homey = c->y;
+      c->x = target->window_area_x +
+             MAX(0, MIN(c->x - m->window_area_x,
+                        target->window_area_width - WIDTH(c)));
+      c->y = target->window_area_y +
+             MAX(0, MIN(c->y - m->window_area_y,
+                        target->window_area_height - HEIGHT(c)));
+      c->mon = target;
+      attach(c);
+      float_index_update(c);
+      attachstack(c);
+      adopted = 1;
+    }
+    m->selected_client = NULL;
+  }
+  arm_hotplug_timer();
+  if (!adopted)
+    return;
+  target->reshow = 1;
+  arrange(target);
+  focus(NULL);
+}
+
+void adopt_parked_clients(void) { adopt_clients(0); }
+
+void adopt_all_parked_clients(void) { adopt_clients(1); }
+
+/* matches monitors to RandR outputs by name; only monitors whose output
+ * appeared, moved or went away are marked dirty */
+int updategeom(void) {
+  OutputGeometry *outputs;
+  Monitor *m, *next, **tail;
+  int i, n, dirty = 0;
+
+  n = query_outputs(&outputs);
+  if (n > 0) {
+    for (i = 0; i < n; i++) {
+      /* the unnamed default monitor is taken over by the first output */
+      for (tail = &monitors; *tail; tail = &(*tail)->next)
+        if (!strcmp((*tail)->output_name, outputs[i].name) ||
+            !(*tail)->output_name[0])
+          break;
+      if (!(m = *tail) && !(m = *tail = unpark_monitor(outputs[i].name))) {
+        m = *tail = createmon();
+        m->dirty = 1;
       }
-    /* removed monitors if n > nn */
-    for (i = nn; i < n; i++) {
-      for (m = monitors; m && m->next; m = m->next)
-        ;
-      while ((c = m->clients)) {
+      snprintf(m->output_name, sizeof m->output_name, "%s", outputs[i].name);
+      m->refresh_rate = outputs[i].refresh_rate;
+      m->mm_width = outputs[i].mm_width;
+      m->mm_height = outputs[i].mm_height;
+      set_monitor_geometry(m, outputs[i].x, outputs[i].y, outputs[i].width,
+                           outputs[i].height);
+    }
+    for (m = monitors; m; m = next) {
+      next = m->next;
+      if (output_index(outputs, n, m->output_name) < 0) {
+        park_monitor(m);
         dirty = 1;
-        m->clients = c->next;
-        detachstack(c);
-        c->mon = monitors;
-        attach(c);
-        attachstack(c);
       }
-      if (m == selected_monitor)
-        selected_monitor = monitors;
-      clean_up_monitors(m);
     }
-    free(unique);
-  } else
-
-  { /* default monitor setup */
+  } else { /* default monitor setup */
     if (!monitors)
       monitors = createmon();
-    if (monitors->screen_width != display_width || monitors->screen_height != display_height) {
-      dirty = 1;
-      monitors->screen_width = monitors->window_area_width = display_width;
-      monitors->screen_height = monitors->window_area_height = display_height;
-      updatebarpos(monitors);
+    set_monitor_geometry(monitors, 0, 0, display_width, display_height);
+  }
+  free(outputs);
+
+  for (i = 0, m = monitors; m; m = m->next, i++) {
+    dirty |= m->dirty;
+    if (m->num != i || !m->monmark[0]) {
+      m->num = i;
+      snprintf(m->monmark, sizeof(m->monmark), "(%d)", m->num);
     }
   }
   if (dirty) {
+    update_topology();
     selected_monitor = monitors;
     selected_monitor = wintomon(root);
   }
@@ -361,11 +936,11 @@ Monitor *wintomon(Window w)
 	Monitor *m;
 
 	if (w == root && getrootptr(&x, &y))
-		return recttomon(x, y, 1, 1);
+		return pointtomon(x, y);
 	for (m = monitors; m; m = m->next)
-		if (w == m->bar_window)
+		if (w == m->bar_window || w == m->sensor)
 			return m;
-	if ((c = get_client_from_window(w)))
+	if ((c = get_client_from_window(w)) && !c->mon->parked)
 		return c->mon;
 	return selected_monitor;
 }
@@ -386,6 +961,7 @@ Monitor *recttomon(int x, int y, int w, int h)
 
 Monitor *createmon(void) {
   Monitor *m;
+  unsigned int i;
 
   m = ecalloc(1, sizeof(Monitor));
   m->tagset[0] = m->tagset[1] = 1;
@@ -396,22 +972,35 @@ Monitor *createmon(void) {
   m->lt[0] = &layouts[0];
   m->lt[1] = &layouts[1 % LENGTH(layouts)];
   strncpy(m->ltsymbol, layouts[0].symbol, sizeof m->ltsymbol);
+  m->pertag = ecalloc(1, sizeof(Pertag));
+  for (i = 0; i <= LENGTH(tags); i++) {
+    m->pertag->nmasters[i] = m->nmaster;
+    m->pertag->mfacts[i] = m->mfact;
+    m->pertag->ltidxs[i][0] = m->lt[0];
+    m->pertag->ltidxs[i][1] = m->lt[1];
+    m->pertag->sellts[i] = m->sellt;
+  }
+  m->pertag->curtag = tag_index(m->tagset[0]);
   /* this is actually set in updategeom, to avoid a race condition */
   //	snprintf(m->monmark, sizeof(m->monmark), "(%d)", m->num);
   return m;
 }
 
 void clean_up_monitors(Monitor *mon) {
-  Monitor *m;
+  Monitor **tm;
+  unsigned int i;
 
-  if (mon == monitors)
-    monitors = monitors->next;
-  else {
-    for (m = monitors; m && m->next != mon; m = m->next)
-      ;
-    m->next = mon->next;
-  }
+  for (tm = mon->parked ? &parked_monitors : &monitors; *tm != mon;
+       tm = &(*tm)->next)
+    ;
+  *tm = mon->next;
   XUnmapWindow(display, mon->bar_window);
   XDestroyWindow(display, mon->bar_window);
+  destroy_highlight_window(mon);
+  destroy_sensor(mon);
+  float_index_free(mon);
+  for (i = 0; i <= LENGTH(tags); i++)
+    free(mon->pertag->caches[i].geometry);
+  free(mon->pertag);
   free(mon);
 }
@@ -4,10 +4,16 @@
 #include "types.h"
 
 typedef struct Monitor Monitor;
+typedef struct Pertag Pertag;
+
+enum { DirLeft, DirRight, DirUp, DirDown, DirLast }; /* neighbour directions */
 
 struct Monitor {
 	char ltsymbol[16];
 	char monmark[16];
+	char output_name[32];           /* RandR output, stable across rescans */
+	double refresh_rate;            /* Hz, 0 when unknown */
+	unsigned long mm_width, mm_height; /* physical size */
 	float mfact;
 	int nmaster;
 	int num;
@@ -17,19 +23,32 @@ struct Monitor {
 	unsigned int seltags;
 	unsigned int sellt;
 	unsigned int tagset[2];
+	unsigned int stackepoch;
+	int reshow;                     /* next showhide revisits every client */
+	int dirty;                      /* geometry changed since the last rescan */
+	int parked;                     /* output is gone, kept for its return */
+	long long parked_at;            /* timer_now() when it was parked */
 	int showbar;
 	int topbar;
 	Client *clients;
 	Client *selected_client;
 	Client *stack;
+	Client *occluder;               /* visible fullscreen client covering the monitor */
+	Client *game;                   /* client the monitor is in game mode for */
 	Monitor *next;
+	Monitor *neighbour[DirLast];    /* nearest monitor in each direction */
 	Window bar_window;
+	Window highlight_window;        /* shaped focus ring, None until first shown */
+	Window sensor;                  /* InputOnly window below all clients, reports crossings */
 	const Layout *lt[2];
+	Pertag *pertag;
+	FloatIndex *floats;             /* edges of the floating clients */
 };
 
 Monitor *createmon(void);
 Monitor *dirtomon(int dir);
 Monitor *numtomon(int num);
+Monitor *pointtomon(int x, int y);
 void focusnthmon(const Arg *arg);
 void tagnthmon(const Arg *arg);
 void draw_bar(Monitor *m);
@@ -37,12 +56,24 @@ void draw_bar(Monitor *m);
 void sendmon(Client *c, Monitor *m);
 
 void focus_monitor(const Arg *arg);
+void focus_monitor_direction(const Arg *arg);
+void tagmon_direction(const Arg *arg);
+void setup_randr(void);
 int updategeom(void);
+void adopt_parked_clients(void);
+void adopt_all_parked_clients(void);
+void hide_highlight(void);
+void update_sensors(void);
 
 void focus_monitor_number(int number);
+void set_mouse_position_to_monitor(Monitor *monitor);
+
+void load_tag_layout(Monitor *m);
+void save_tag_layout(Monitor *m);
 
 
-extern Monitor *monitors, *selected_monitor;
+extern Monitor *monitors, *selected_monitor, *parked_monitors;
+extern int randr_event_base;
 
 
 #endif
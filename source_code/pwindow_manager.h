@@ -50,6 +50,7 @@ int gettextprop(Window w, Atom atom, char *text, unsigned int size);
 
 void grabbuttons(Client *c, int focused);
 void grabkeys(void);
+void regrab_buttons(void);
 void incnmaster(const Arg *arg);
 void keypress(XEvent *e);
 void killclient(const Arg *arg);
@@ -57,7 +58,6 @@ void setup_window(Window w, XWindowAttributes *wa);
 void mappingnotify(XEvent *e);
 void maprequest(XEvent *e);
 void monocle(Monitor *m);
-void motionnotify(XEvent *e);
 
 void movetoedge(const Arg *arg);
 void moveresize(const Arg *arg);
@@ -75,6 +75,8 @@ void pushdown(const Arg *arg);
 void pushup(const Arg *arg);
 
 void resize(Client *c, int x, int y, int w, int h, int interact);
+void defer_resize(Client *c, int x, int y, int w, int h);
+void apply_deferred_resize(Client *c);
 void resizeclient(Client *c, int x, int y, int w, int h);
 void restack(Monitor *m);
 void run(void);
@@ -104,6 +106,7 @@ void unmanage(Client *c, int destroyed);
 void unmapnotify(XEvent *e);
 void updatebarpos(Monitor *m);
 void create_bars(void);
+void resize_bar_surface(void);
 void updateclientlist(void);
 
 void updatenumlockmask(void);
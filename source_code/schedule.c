@@ -0,0 +1,124 @@
+#include "schedule.h"
+
+#include "pwindow_manager.h"
+#include "config.h"
+#include "timer.h"
+#include <stdio.h>
+
+/* events looked at per scan, the rest of the queue waits its turn */
+#define SCAN_LENGTH 64
+
+enum { ClassInput, ClassStructure, ClassOther };
+
+typedef struct {
+  int class;                    /* highest class the scan takes */
+  int seen;                     /* events looked at so far */
+  int n;
+  Window windows[SCAN_LENGTH];  /* windows of the events left queued */
+} Scan;
+
+static long long skew; /* server time minus local time, largest seen */
+static int skew_known;
+
+static int event_class(XEvent *ev) {
+  switch (ev->type) {
+  case KeyPress:
+  case KeyRelease:
+  case ButtonPress:
+  case ButtonRelease:
+  case MotionNotify:
+    return ClassInput;
+  case PropertyNotify:
+  case Expose:
+    return ClassOther;
+  }
+  return ClassStructure;
+}
+
+/* the window an event is about, xany.window is the parent for requests
+ * and substructure notifies */
+static Window event_window(XEvent *ev) {
+  switch (ev->type) {
+  case MapRequest:
+    return ev->xmaprequest.window;
+  case ConfigureRequest:
+    return ev->xconfigurerequest.window;
+  case ConfigureNotify:
+    return ev->xconfigure.window;
+  case DestroyNotify:
+    return ev->xdestroywindow.window;
+  case UnmapNotify:
+    return ev->xunmap.window;
+  case CreateNotify:
+    return ev->xcreatewindow.window;
+  case MapNotify:
+    return ev->xmap.window;
+  case ReparentNotify:
+    return ev->xreparent.window;
+  case GravityNotify:
+    return ev->xgravity.window;
+  case CirculateNotify:
+    return ev->xcirculate.window;
+  case CirculateRequest:
+    return ev->xcirculaterequest.window;
+  }
+  return ev->xany.window;
+}
+
+static Bool is_ready(Display *dpy, XEvent *ev, XPointer arg) {
+  Scan *scan = (Scan *)arg;
+  Window w = event_window(ev);
+  int i, class = event_class(ev);
+
+  if (scan->seen == SCAN_LENGTH)
+    return False;
+  scan->seen++;
+  for (i = 0; i < scan->n && scan->windows[i] != w; i++)
+    ;
+  if (i == scan->n && class <= scan->class)
+    return True;
+  /* input keeps its order, nothing passes input left queued; keys behind
+   * a keymap change are decoded with the new map */
+  if (class == ClassInput || ev->type == MappingNotify) {
+    scan->seen = SCAN_LENGTH;
+    return False;
+  }
+  if (i < scan->n)
+    return False;
+  /* the status text on root orders nothing after it */
+  if (w != root || class != ClassOther)
+    scan->windows[scan->n++] = w;
+  return False;
+}
+
+int next_event(XEvent *ev) {
+  Scan scan = {.class = ClassOther};
+
+  if (XEventsQueued(display, QueuedAlready) > 1)
+    for (scan.class = ClassInput; scan.class < ClassOther; scan.class++) {
+      scan.seen = scan.n = 0;
+      if (XCheckIfEvent(display, ev, is_ready, (XPointer)&scan))
+        break;
+    }
+  if (scan.class == ClassOther) {
+    XNextEvent(display, ev);
+    scan.seen = 1;
+  }
+  if (report_key_latency && ev->type == KeyPress &&
+      (!skew_known || (long long)ev->xkey.time - timer_now() > skew)) {
+    skew = (long long)ev->xkey.time - timer_now();
+    skew_known = 1;
+  }
+  return scan.seen - 1;
+}
+
+/* ev has been handled, the press to action time is measured against the
+ * smallest delay seen between a press and its arrival */
+void report_key(XEvent *ev, int jumped) {
+  if (!report_key_latency || ev->type != KeyPress)
+    return;
+  fprintf(stderr,
+          "pwindow_manager: key handled %lld ms after the press, "
+          "ahead of %d queued events\n",
+          timer_now() + skew - (long long)ev->xkey.time, jumped);
+}
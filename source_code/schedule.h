@@ -0,0 +1,12 @@
+#ifndef SCHEDULE_H
+#define SCHEDULE_H
+
+#include <X11/Xlib.h>
+
+/* takes the next event to handle: user input first, then structural
+ * events, property and expose traffic last, never ahead of an earlier
+ * event of the same window; returns how many queued events it jumped */
+int next_event(XEvent *ev);
+void report_key(XEvent *ev, int jumped);
+
+#endif
@@ -0,0 +1,195 @@
+#include "shadow.h"
+
+#include "pwindow_manager.h"
+#include "config.h"
+#include <X11/Xatom.h>
+#include <stdio.h>
+#include <time.h>
+
+static unsigned int requests_sent, requests_suppressed;
+static struct timespec report_start;
+
+int shadow_configure(Client *c, unsigned int mask, XWindowChanges *wc) {
+  Shadow *s = &c->shadow;
+
+  if ((s->configured & CWX) && wc->x == s->x)
+    mask &= ~CWX;
+  if ((s->configured & CWY) && wc->y == s->y)
+    mask &= ~CWY;
+  if ((s->configured & CWWidth) && wc->width == s->w)
+    mask &= ~CWWidth;
+  if ((s->configured & CWHeight) && wc->height == s->h)
+    mask &= ~CWHeight;
+  if ((s->configured & CWBorderWidth) && wc->border_width == s->border_width)
+    mask &= ~CWBorderWidth;
+  /* only relative placements can be compared, a raise is always sent */
+  if ((mask & CWSibling) && (s->configured & CWSibling) &&
+      wc->sibling == s->sibling && wc->stack_mode == s->stack_mode)
+    mask &= ~(CWSibling | CWStackMode);
+
+  if (!mask) {
+    requests_suppressed++;
+    return 0;
+  }
+  XConfigureWindow(display, c->win, mask, wc);
+  requests_sent++;
+
+  if (mask & CWX)
+    s->x = wc->x;
+  if (mask & CWY)
+    s->y = wc->y;
+  if (mask & CWWidth)
+    s->w = wc->width;
+  if (mask & CWHeight)
+    s->h = wc->height;
+  if (mask & CWBorderWidth)
+    s->border_width = wc->border_width;
+  if (mask & CWStackMode) {
+    s->stack_mode = wc->stack_mode;
+    s->sibling = mask & CWSibling ? wc->sibling : None;
+    if (!(mask & CWSibling))
+      c->stackepoch = 0; /* raised out of the tiled stacking order */
+  }
+  s->configured |= mask & (CWX | CWY | CWWidth | CWHeight | CWBorderWidth);
+  if (mask & CWStackMode)
+    s->configured |= CWSibling;
+  return 1;
+}
+
+int shadow_move(Client *c, int x, int y) {
+  XWindowChanges wc = {.x = x, .y = y};
+
+  return shadow_configure(c, CWX | CWY, &wc);
+}
+
+int shadow_move_resize(Client *c, int x, int y, int w, int h) {
+  XWindowChanges wc = {.x = x, .y = y, .width = w, .height = h};
+
+  return shadow_configure(c, CWX | CWY | CWWidth | CWHeight, &wc);
+}
+
+void shadow_raise(Client *c) {
+  XWindowChanges wc = {.stack_mode = Above};
+
+  shadow_configure(c, CWStackMode, &wc);
+}
+
+void shadow_map(Client *c) {
+  Shadow *s = &c->shadow;
+
+  if ((s->known & ShadowMapped) && s->mapped) {
+    requests_suppressed++;
+    return;
+  }
+  XMapWindow(display, c->win);
+  requests_sent++;
+  s->mapped = 1;
+  s->known |= ShadowMapped;
+}
+
+void shadow_unmap(Client *c) {
+  Shadow *s = &c->shadow;
+
+  if ((s->known & ShadowMapped) && !s->mapped) {
+    requests_suppressed++;
+    return;
+  }
+  c->unmapserial = NextRequest(display);
+  XUnmapWindow(display, c->win);
+  requests_sent++;
+  s->mapped = 0;
+  s->known |= ShadowMapped;
+  c->ignoreunmap += 2; /* reported to the window and to root */
+}
+
+void shadow_set_border(Client *c, unsigned long pixel) {
+  Shadow *s = &c->shadow;
+
+  if ((s->known & ShadowBorderPixel) && s->border_pixel == pixel) {
+    requests_suppressed++;
+    return;
+  }
+  XSetWindowBorder(display, c->win, pixel);
+  requests_sent++;
+  s->border_pixel = pixel;
+  s->known |= ShadowBorderPixel;
+}
+
+/* returns 1 when the caller has to (re)grab the buttons of c */
+int shadow_grab_buttons(Client *c, int focused) {
+  Shadow *s = &c->shadow;
+
+  if ((s->known & ShadowGrab) && s->grab_focused == focused) {
+    requests_suppressed++;
+    return 0;
+  }
+  requests_sent++;
+  s->grab_focused = focused;
+  s->known |= ShadowGrab;
+  return 1;
+}
+
+/* the next shadow_grab_buttons of c asks for a regrab */
+void shadow_forget_grab(Client *c) { c->shadow.known &= ~ShadowGrab; }
+
+/* the next stacking request of c is sent whatever it restacks against */
+void shadow_forget_stacking(Client *c) { c->shadow.configured &= ~CWSibling; }
+
+void shadow_set_wm_state(Client *c, long state) {
+  Shadow *s = &c->shadow;
+  long data[] = {state, None};
+
+  if ((s->known & ShadowWMState) && s->wm_state == state) {
+    requests_suppressed++;
+    return;
+  }
+  XChangeProperty(display, c->win, wmatom[WMState], wmatom[WMState], 32,
+                  PropModeReplace, (unsigned char *)data, 2);
+  requests_sent++;
+  s->wm_state = state;
+  s->known |= ShadowWMState;
+}
+
+void shadow_set_net_wm_state(Client *c, unsigned int state) {
+  Shadow *s = &c->shadow;
+  Atom atoms[2];
+  int n = 0;
+
+  if ((s->known & ShadowNetWMState) && s->net_wm_state == state) {
+    requests_suppressed++;
+    return;
+  }
+  if (state & NetStateFullscreen)
+    atoms[n++] = netatom[NetWMFullscreen];
+  if (state & NetStateHidden)
+    atoms[n++] = netatom[NetWMHidden];
+  XChangeProperty(display, c->win, netatom[NetWMState], XA_ATOM, 32,
+                  PropModeReplace, (unsigned char *)atoms, n);
+  requests_sent++;
+  s->net_wm_state = state;
+  s->known |= ShadowNetWMState;
+}
+
+/* prints the rates of sent and suppressed requests, at most once a second */
+void shadow_report(void) {
+  struct timespec now;
+  double elapsed;
+
+  if (!report_xrequests)
+    return;
+  clock_gettime(CLOCK_MONOTONIC, &now);
+  if (!report_start.tv_sec && !report_start.tv_nsec) {
+    report_start = now;
+    return;
+  }
+  elapsed = (now.tv_sec - report_start.tv_sec) +
+            (now.tv_nsec - report_start.tv_nsec) / 1e9;
+  if (elapsed < 1.0)
+    return;
+  if (requests_sent || requests_suppressed)
+    fprintf(stderr,
+            "pwindow_manager: x requests %.1f/s sent, %.1f/s suppressed\n",
+            requests_sent / elapsed, requests_suppressed / elapsed);
+  requests_sent = requests_suppressed = 0;
+  report_start = now;
+}
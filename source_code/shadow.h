@@ -0,0 +1,24 @@
+#ifndef SHADOW_H
+#define SHADOW_H
+
+#include <X11/Xlib.h>
+#include "types.h"
+
+/* every request that mutates a client window goes through here; requests
+ * matching the shadowed server state are dropped */
+int shadow_configure(Client *c, unsigned int mask, XWindowChanges *wc);
+int shadow_move(Client *c, int x, int y);
+int shadow_move_resize(Client *c, int x, int y, int w, int h);
+void shadow_raise(Client *c);
+void shadow_map(Client *c);
+void shadow_unmap(Client *c);
+void shadow_set_border(Client *c, unsigned long pixel);
+int shadow_grab_buttons(Client *c, int focused);
+void shadow_forget_grab(Client *c);
+void shadow_forget_stacking(Client *c);
+void shadow_set_wm_state(Client *c, long state);
+void shadow_set_net_wm_state(Client *c, unsigned int state);
+
+void shadow_report(void);
+
+#endif
@@ -0,0 +1,70 @@
+#include "timer.h"
+
+#include "events.h"
+#include "monitors.h"
+#include <time.h>
+
+static void (*const callbacks[TimerLast])(void) = {
+    [TimerHotplug] = adopt_parked_clients,
+    [TimerHighlight] = hide_highlight,
+    [TimerFocus] = focus_entered,
+};
+
+static struct timespec deadlines[TimerLast];
+static int armed;
+
+long long timer_now(void) {
+  struct timespec now;
+
+  clock_gettime(CLOCK_MONOTONIC, &now);
+  return now.tv_sec * 1000LL + now.tv_nsec / 1000000;
+}
+
+static long long deadline_ms(int timer) {
+  return deadlines[timer].tv_sec * 1000LL + deadlines[timer].tv_nsec / 1000000;
+}
+
+void timer_start(int timer, int ms) {
+  long long at = timer_now() + ms;
+
+  deadlines[timer].tv_sec = at / 1000;
+  deadlines[timer].tv_nsec = at % 1000 * 1000000;
+  armed |= 1 << timer;
+}
+
+void timer_stop(int timer) { armed &= ~(1 << timer); }
+
+int timer_pending(int timer) { return armed & 1 << timer; }
+
+/* milliseconds until the next timer expires, -1 when none is armed */
+int timer_timeout(void) {
+  long long now, left, next = -1;
+  int i;
+
+  if (!armed)
+    return -1;
+  now = timer_now();
+  for (i = 0; i < TimerLast; i++)
+    if (armed & 1 << i) {
+      left = deadline_ms(i) - now;
+      if (left < 0)
+        left = 0;
+      if (next < 0 || left < next)
+        next = left;
+    }
+  return next;
+}
+
+void timer_run_expired(void) {
+  long long now;
+  int i;
+
+  if (!armed)
+    return;
+  now = timer_now();
+  for (i = 0; i < TimerLast; i++)
+    if ((armed & 1 << i) && deadline_ms(i) <= now) {
+      armed &= ~(1 << i);
+      callbacks[i]();
+    }
+}
@@ -0,0 +1,14 @@
+#ifndef TIMER_H
+#define TIMER_H
+
+/* one-shot timers run from the main loop, one slot per purpose */
+enum { TimerHotplug, TimerHighlight, TimerFocus, TimerLast };
+
+void timer_start(int timer, int ms);
+void timer_stop(int timer);
+int timer_pending(int timer);
+int timer_timeout(void);
+long long timer_now(void);
+void timer_run_expired(void);
+
+#endif
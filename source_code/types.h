@@ -23,11 +23,15 @@
 enum { CurNormal, CurResize, CursorMove, CurLast }; /* cursor */
 enum { SchemeNormal, SchemeSelected }; /* color schemes */
 enum { NetSupported, NetWMName, NetWMState, NetWMCheck,
-       NetWMFullscreen, NetActiveWindow, NetWMWindowType,
-       NetWMWindowTypeDialog, NetClientList, NetLast }; /* EWMH atoms */
+       NetWMFullscreen, NetWMHidden, NetActiveWindow, NetWMWindowType,
+       NetWMWindowTypeDialog, NetClientList, NetWMBypassCompositor,
+       NetWMPid, NetWMSyncRequest, NetWMSyncRequestCounter, NetLast }; /* EWMH atoms */
 enum { WMProtocols, WMDelete, WMState, WMTakeFocus, WMLast }; /* default atoms */
 enum { ClkTagBar, ClkLtSymbol, ClkMonNum, ClkStatusText, ClkWinTitle,
        ClkClientWin, ClkRootWin, ClkLast }; /* clicks */
+enum { ShadowMapped = 1 << 0, ShadowBorderPixel = 1 << 1, ShadowGrab = 1 << 2,
+       ShadowWMState = 1 << 3, ShadowNetWMState = 1 << 4 }; /* shadow fields */
+enum { NetStateFullscreen = 1 << 0, NetStateHidden = 1 << 1 }; /* _NET_WM_STATE bits */
 
 
 typedef union {
@@ -45,7 +49,23 @@ typedef struct {
 	const Arg arg;
 } Button;
 
+/* what the X server is known to hold for a client window, so requests
+ * that would not change anything can be dropped */
+typedef struct {
+	int x, y, w, h, border_width;
+	Window sibling;
+	int stack_mode;
+	unsigned int configured;        /* CW* bits of the fields above that are known */
+	unsigned int known;             /* Shadow* bits of the fields below that are known */
+	int mapped;
+	unsigned long border_pixel;
+	int grab_focused;
+	long wm_state;
+	unsigned int net_wm_state;
+} Shadow;
+
 typedef struct Monitor Monitor;
+typedef struct FloatIndex FloatIndex;
 typedef struct Client Client;
 struct Client {
 	char name[256];
@@ -56,10 +76,24 @@ struct Client {
 	int border_width, oldbw;
 	unsigned int tags;
 	int isfixed, isfloating, isurgent, neverfocus, oldstate, isfullscreen;
+	int isgame, gamepid, oldnice;
+	int isdeferred, deferx, defery, deferw, deferh; /* resize waiting to be applied */
+	int isshown;                    /* placed on screen by showhide */
+	int needsmap;                   /* shown while unmapped, mapped after the arrange */
+	int ignoreunmap;                /* UnmapNotify events caused by hiding */
+	unsigned long unmapserial;      /* request serial of the last hiding unmap */
+	int stackpos;                   /* index in the last stacking order sent */
+	unsigned int stackepoch;        /* stackpos is valid while this matches the monitor's */
 	Client *next;
 	Client *snext;
 	Monitor *mon;
+	Monitor *home;                  /* parked monitor the client was adopted from */
+	Monitor *indexmon;              /* monitor whose floating index holds the client */
+	int indexx, indexy, indexw, indexh; /* outer geometry it was indexed with */
+	unsigned int hometags;
+	int homex, homey;
 	Window win;
+	Shadow shadow;
 };
 
 typedef struct {
@@ -69,6 +103,13 @@ typedef struct {
 	const Arg arg;
 } Key;
 
+typedef struct {
+	const char *name;
+	const Key *keys;
+	unsigned int length;
+	int oneshot;                    /* leave after the first key, a chord */
+} Submap;
+
 typedef struct {
 	const char *symbol;
 	void (*arrange)(Monitor *);
@@ -82,6 +123,7 @@ typedef struct {
 	unsigned int tags;
 	int isfloating;
 	int monitor;
+	int isgame;
 } Rule;
 
 
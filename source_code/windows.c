@@ -4,29 +4,158 @@
 
 #include "config.h"
 #include "util.h"
+#include "shadow.h"
+#include "floating.h"
+#include "timer.h"
 #include <X11/Xatom.h>
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <sys/resource.h>
 
 const char broken[] = "broken";
 
-void showhide(Client *c) {
-  if (!c)
+static void hide_client(Client *c) {
+  if (!hidden_unmap) {
+    shadow_move(c, WIDTH(c) * -2, c->y);
     return;
-  if (ISVISIBLE(c)) {
-    /* show clients top down */
-    XMoveWindow(display, c->win, c->x, c->y);
-    if ((!c->mon->lt[c->mon->sellt]->arrange || c->isfloating) &&
-        !c->isfullscreen)
+  }
+  shadow_unmap(c);
+  setclientstate(c, IconicState);
+  shadow_set_net_wm_state(c, c->shadow.net_wm_state | NetStateHidden);
+}
+
+/* only clients whose visibility changed since the last call are touched,
+ * unless m->reshow asks for all of them */
+void showhide(Monitor *m) {
+  static Client **hidden;
+  static int size;
+  Client *c;
+  int n = 0;
+
+  for (c = m->stack; c; c = c->snext)
+    if (!ISVISIBLE(c) && (c->isshown || m->reshow))
+      n++;
+  if (n > size) {
+    free(hidden);
+    hidden = ecalloc(n, sizeof(Client *));
+    size = n;
+  }
+
+  /* show clients top down */
+  for (n = 0, c = m->stack; c; c = c->snext) {
+    if (!ISVISIBLE(c)) {
+      if (c->isshown || m->reshow)
+        hidden[n++] = c;
+      continue;
+    }
+    if (c->isshown && !m->reshow)
+      continue;
+    shadow_move(c, c->x, c->y);
+    if ((!m->lt[m->sellt]->arrange || c->isfloating) && !c->isfullscreen)
       resize(c, c->x, c->y, c->w, c->h, 0);
-    showhide(c->snext);
-  } else {
-    /* hide clients bottom up */
-    showhide(c->snext);
-    XMoveWindow(display, c->win, WIDTH(c) * -2, c->y);
+    c->isshown = 1;
+    c->needsmap = hidden_unmap;
+  }
+  /* hide clients bottom up */
+  while (n--) {
+    c = hidden[n];
+    hide_client(c);
+    c->isshown = 0;
+    c->needsmap = 0;
   }
+  m->reshow = 0;
+}
+
+/* takes every client of m off screen, its output went away */
+void hide_clients(Monitor *m) {
+  Client *c;
+
+  for (c = m->stack; c; c = c->snext)
+    if (c->isshown) {
+      hide_client(c);
+      c->isshown = 0;
+      c->needsmap = 0;
+    }
+  m->reshow = 1;
+}
+
+/* maps the clients showhide brought back once the layout has configured and
+ * stacked them, top down, so they appear in place */
+void map_shown_clients(Monitor *m) {
+  Client *c;
+
+  for (c = m->stack; c; c = c->snext)
+    if (c->needsmap) {
+      shadow_map(c);
+      setclientstate(c, NormalState);
+      shadow_set_net_wm_state(c, c->shadow.net_wm_state & ~NetStateHidden);
+      c->needsmap = 0;
+    }
+}
+
+static pid_t client_pid(Client *c) {
+  int format;
+  unsigned long n, extra;
+  unsigned char *p = NULL;
+  Atom real;
+  pid_t pid = 0;
+
+  if (XGetWindowProperty(display, c->win, netatom[NetWMPid], 0L, 1L, False,
+                         XA_CARDINAL, &real, &format, &n, &extra,
+                         &p) == Success &&
+      p) {
+    if (n)
+      pid = *(long *)p;
+    XFree(p);
+  }
+  return pid;
+}
+
+static void enter_game_mode(Client *c) {
+  long bypass = 1;
+
+  XChangeProperty(display, c->win, netatom[NetWMBypassCompositor], XA_CARDINAL,
+                  32, PropModeReplace, (unsigned char *)&bypass, 1);
+  if ((c->gamepid = client_pid(c)) <= 0)
+    return;
+  errno = 0;
+  c->oldnice = getpriority(PRIO_PROCESS, c->gamepid);
+  if (errno || setpriority(PRIO_PROCESS, c->gamepid, game_nice) < 0) {
+    fprintf(stderr, "pwindow_manager: cannot renice game %d\n", c->gamepid);
+    c->gamepid = 0;
+  }
+}
+
+static void leave_game_mode(Client *c) {
+  XDeleteProperty(display, c->win, netatom[NetWMBypassCompositor]);
+  if (c->gamepid > 0)
+    setpriority(PRIO_PROCESS, c->gamepid, c->oldnice);
+  c->gamepid = 0;
+}
+
+/* a monitor is in game mode while it shows a fullscreen client or one a rule
+ * marks as game: its bar, focus follows mouse and highlight are suspended */
+void update_game_mode(Monitor *m) {
+  Client *c;
+
+  for (c = m->parked ? NULL : m->clients; c; c = c->next)
+    if (ISVISIBLE(c) && (c->isfullscreen || c->isgame))
+      break;
+  if (c == m->game)
+    return;
+  if (m->game)
+    leave_game_mode(m->game);
+  if ((m->game = c))
+    enter_game_mode(c);
+  else
+    draw_bar(m);
 }
 
 void focus(Client *client) {
  
+  /* any focus decision overrides a crossing still dwelling */
+  timer_stop(TimerFocus);
   if (!client || !ISVISIBLE(client)){
 
     for (client = selected_monitor->stack; client && !ISVISIBLE(client); client = client->snext)
@@ -47,9 +176,13 @@ void focus(Client *client) {
 
     detachstack(client);
     attachstack(client);
+    apply_deferred_resize(client);
+    if (monocle_presize && !client->isfloating)
+      apply_deferred_resize(nexttiled(client->next) ? nexttiled(client->next)
+                                                    : nexttiled(client->mon->clients));
     grabbuttons(client, 1);
 
-    XSetWindowBorder(display, client->win, color_scheme[SchemeSelected][ColBorder].pixel);
+    shadow_set_border(client, color_scheme[SchemeSelected][ColBorder].pixel);
 
     setfocus(client);
 
@@ -107,9 +240,7 @@ void setfocus(Client *c) {
 
 void setfullscreen(Client *c, int fullscreen) {
   if (fullscreen && !c->isfullscreen) {
-    XChangeProperty(display, c->win, netatom[NetWMState], XA_ATOM, 32,
-                    PropModeReplace, (unsigned char *)&netatom[NetWMFullscreen],
-                    1);
+    shadow_set_net_wm_state(c, c->shadow.net_wm_state | NetStateFullscreen);
     c->isfullscreen = 1;
     c->oldstate = c->isfloating;
     c->oldbw = c->border_width;
@@ -117,10 +248,10 @@ void setfullscreen(Client *c, int fullscreen) {
     c->isfloating = 1;
     resizeclient(c, c->mon->screen_x, c->mon->screen_y, c->mon->screen_width,
                  c->mon->screen_height);
-    XRaiseWindow(display, c->win);
+    shadow_raise(c);
+    update_game_mode(c->mon);
   } else if (!fullscreen && c->isfullscreen) {
-    XChangeProperty(display, c->win, netatom[NetWMState], XA_ATOM, 32,
-                    PropModeReplace, (unsigned char *)0, 0);
+    shadow_set_net_wm_state(c, c->shadow.net_wm_state & ~NetStateFullscreen);
     c->isfullscreen = 0;
     c->isfloating = c->oldstate;
     c->border_width = c->oldbw;
@@ -170,6 +301,8 @@ void setup_window(Window w, XWindowAttributes *window_attributes) {
   client->w = client->oldw = window_attributes->width;
   client->h = client->oldh = window_attributes->height;
   client->oldbw = window_attributes->border_width;
+  client->shadow.mapped = window_attributes->map_state != IsUnmapped;
+  client->shadow.known |= ShadowMapped;
 
   updatetitle(client);
   if (XGetTransientForHint(display, w, &transient_window) &&
@@ -194,8 +327,8 @@ void setup_window(Window w, XWindowAttributes *window_attributes) {
   client->border_width = borderpx;
 
   window_changes.border_width = client->border_width;
-  XConfigureWindow(display, w, CWBorderWidth, &window_changes);
-  XSetWindowBorder(display, w, color_scheme[SchemeNormal][ColBorder].pixel);
+  shadow_configure(client, CWBorderWidth, &window_changes);
+  shadow_set_border(client, color_scheme[SchemeNormal][ColBorder].pixel);
   configure(client); /* propagates border_width, if size doesn't change */
   updatewindowtype(client);
   updatesizehints(client);
@@ -207,32 +340,60 @@ void setup_window(Window w, XWindowAttributes *window_attributes) {
   if (!client->isfloating)
     client->isfloating = client->oldstate =
         transient_window != None || client->isfixed;
+  if (client->isfloating && place_floating_windows && !window_attributes->x &&
+      !window_attributes->y && transient_window == None)
+    place_floating(client);
   if (client->isfloating)
-    XRaiseWindow(display, client->win);
+    shadow_raise(client);
   attach(client);
+  float_index_update(client);
   attachstack(client);
   XChangeProperty(display, root, netatom[NetClientList], XA_WINDOW, 32,
                   PropModeAppend, (unsigned char *)&(client->win), 1);
-  XMoveResizeWindow(display, client->win, client->x + 2 * display_width,
-                    client->y, client->w,
-                    client->h); /* some windows require this */
+  shadow_move_resize(client, client->x + 2 * display_width, client->y,
+                     client->w, client->h); /* some windows require this */
   setclientstate(client, NormalState);
   if (client->mon == selected_monitor)
     unfocus(selected_monitor->selected_client, 0);
   client->mon->selected_client = client;
   arrange(client->mon);
-  XMapWindow(display, client->win);
+  if (ISVISIBLE(client) || !hidden_unmap)
+    shadow_map(client);
+  else
+    hide_client(client);
   focus(NULL);
 }
 
 void resize(Client *c, int x, int y, int w, int h, int interact) {
+  if (!interact && !c->isfloating && c->mon->occluder &&
+      c->mon->occluder != c) {
+    defer_resize(c, x, y, w, h); /* nobody can see it below the fullscreen client */
+    return;
+  }
+  c->isdeferred = 0;
   if (applysizehints(c, &x, &y, &w, &h, interact))
     resizeclient(c, x, y, w, h);
 }
 
+/* remembers a layout resize of a client nobody sees yet, it is applied
+ * with apply_deferred_resize once the client comes up */
+void defer_resize(Client *c, int x, int y, int w, int h) {
+  c->isdeferred = 1;
+  c->deferx = x;
+  c->defery = y;
+  c->deferw = w;
+  c->deferh = h;
+}
+
+void apply_deferred_resize(Client *c) {
+  if (c && c->isdeferred)
+    resize(c, c->deferx, c->defery, c->deferw, c->deferh, 0);
+}
+
 void resizeclient(Client *c, int x, int y, int w, int h) {
   XWindowChanges wc;
 
+  c->isdeferred = 0;
   c->oldx = c->x;
   c->x = wc.x = x;
   c->oldy = c->y;
@@ -242,10 +403,11 @@ void resizeclient(Client *c, int x, int y, int w, int h) {
   c->oldh = c->h;
   c->h = wc.height = h;
   wc.border_width = c->border_width;
-  XConfigureWindow(display, c->win, CWX | CWY | CWWidth | CWHeight | CWBorderWidth,
-                   &wc);
-  configure(c);
-  XSync(display, False);
+  if (shadow_configure(c, CWX | CWY | CWWidth | CWHeight | CWBorderWidth, &wc)) {
+    configure(c);
+    XSync(display, False);
+  }
+  float_index_update(c);
 }
 
 void window_to_monitor(const Arg *arg) {
@@ -285,7 +447,9 @@ void window_to_monitor_and_focus(const Arg *arg) {
   window->mon = monitor;
   window->tags =
       monitor->tagset[monitor->seltags]; /* assign tags of target monitor */
+  monitor->reshow = 1;
   attach(window);
+  float_index_update(window);
   attachstack(window);
 
   focus(window);
@@ -320,7 +484,7 @@ void unfocus(Client *c, int setfocus) {
   if (!c)
     return;
   grabbuttons(c, 0);
-  XSetWindowBorder(display, c->win, color_scheme[SchemeNormal][ColBorder].pixel);
+  shadow_set_border(c, color_scheme[SchemeNormal][ColBorder].pixel);
   if (setfocus) {
     XSetInputFocus(display, root, RevertToPointerRoot, CurrentTime);
     XDeleteProperty(display, root, netatom[NetActiveWindow]);
@@ -339,17 +503,21 @@ void togglefloating(const Arg *arg) {
     resize(selected_monitor->selected_client, selected_monitor->selected_client->x,
            selected_monitor->selected_client->y, selected_monitor->selected_client->w,
            selected_monitor->selected_client->h, 0);
+  float_index_update(selected_monitor->selected_client);
   arrange(selected_monitor);
 }
 
 Client *get_client_from_window(Window w) {
+  Monitor *lists[] = {monitors, parked_monitors};
   Client *c;
   Monitor *m;
+  size_t i;
 
-  for (m = monitors; m; m = m->next)
-    for (c = m->clients; c; c = c->next)
-      if (c->win == w)
-        return c;
+  for (i = 0; i < LENGTH(lists); i++)
+    for (m = lists[i]; m; m = m->next)
+      for (c = m->clients; c; c = c->next)
+        if (c->win == w)
+          return c;
   return NULL;
 }
 
@@ -469,6 +637,29 @@ int applysizehints(Client *c, int *x, int *y, int *w, int *h, int interact) {
   return *x != c->x || *y != c->y || *w != c->w || *h != c->h;
 }
 
+/* position of a w x h client of the selected monitor against the edges
+ * x and y: -1 left/top, 0 centered, 1 right/bottom, else unchanged */
+static void edge_position(Client *c, int x, int y, int w, int h, int *nx,
+                          int *ny) {
+  if (x == 0)
+    *nx = (selected_monitor->screen_width - w) / 2;
+  else if (x == -1)
+    *nx = borderpx;
+  else if (x == 1)
+    *nx = selected_monitor->screen_width - (w + 2 * borderpx);
+  else
+    *nx = c->x;
+
+  if (y == 0)
+    *ny = (selected_monitor->screen_height - (h + bar_height)) / 2;
+  else if (y == -1)
+    *ny = bar_height + borderpx;
+  else if (y == 1)
+    *ny = selected_monitor->screen_height - (h + 2 * borderpx);
+  else
+    *ny = c->y;
+}
+
 void movetoedge(const Arg *arg) {
 
   // only floating windows can be moved/
@@ -484,43 +675,33 @@ void movetoedge(const Arg *arg) {
   if (sscanf((char *)arg->v, "%d %d", &x, &y) != 2)
     return;
 
-  if (x == 0)
-    nx = (selected_monitor->screen_width - c->w) / 2;
-  else if (x == -1)
-    nx = borderpx;
-  else if (x == 1)
-    nx = selected_monitor->screen_width - (c->w + 2 * borderpx);
-  else
-    nx = c->x;
-
-  if (y == 0)
-    ny = (selected_monitor->screen_height - (c->h + bar_height)) / 2;
-  else if (y == -1)
-    ny = bar_height + borderpx;
-  else if (y == 1)
-    ny = selected_monitor->screen_height - (c->h + 2 * borderpx);
-  else
-    ny = c->y;
-
-  XRaiseWindow(display, c->win);
+  edge_position(c, x, y, c->w, c->h, &nx, &ny);
+  shadow_raise(c);
   resize(c, nx, ny, c->w, c->h, True);
 }
 
+/* resizes by the deltas and moves to the bottom right corner, in one
+ * configure */
 void moveresizewebcam(const Arg *arg) {
   XEvent ev;
   Monitor *m = selected_monitor;
+  Client *c = m->selected_client;
+  int x, y, w, h;
 
-  if (!(m->selected_client && arg && arg->v && m->selected_client->isfloating))
+  if (!(c && arg && arg->v && c->isfloating))
     return;
 
-  resize(m->selected_client, m->selected_client->x + ((int *)arg->v)[0], m->selected_client->y + ((int *)arg->v)[1],
-         m->selected_client->w + ((int *)arg->v)[2], m->selected_client->h + ((int *)arg->v)[3], True);
+  x = c->x + ((int *)arg->v)[0];
+  y = c->y + ((int *)arg->v)[1];
+  w = c->w + ((int *)arg->v)[2];
+  h = c->h + ((int *)arg->v)[3];
+  applysizehints(c, &x, &y, &w, &h, True);
+  edge_position(c, 1, 1, w, h, &x, &y);
+  shadow_raise(c);
+  resize(c, x, y, w, h, True);
 
   while (XCheckMaskEvent(display, EnterWindowMask, &ev))
     ;
-  Arg new_arg;
-  new_arg.v = "1 1";
-  movetoedge(&new_arg);
 }
 
 void moveresize(const Arg *arg) {
@@ -567,10 +748,7 @@ void killclient(const Arg *arg) {
 }
 
 void setclientstate(Client *c, long state) {
-  long data[] = {state, None};
-
-  XChangeProperty(display, c->win, wmatom[WMState], wmatom[WMState], 32,
-                  PropModeReplace, (unsigned char *)data, 2);
+  shadow_set_wm_state(c, state);
 }
 
 void updatesizehints(Client *c) {
@@ -17,7 +17,13 @@ void attach(Client *c);
 
 void attachstack(Client *c);
 
-void showhide(Client *c);
+void showhide(Monitor *m);
+
+void map_shown_clients(Monitor *m);
+
+void hide_clients(Monitor *m);
+
+void update_game_mode(Monitor *m);
 
 void scan_windows(void);
 